@@ -0,0 +1,187 @@
+/******************************************************************************
+ * CPU and NUMA placement of worker threads.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#define _GNU_SOURCE			// CPU sets and affinity calls
+
+#include <ctype.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "affinity.h"
+
+#define NODE_CPULIST "/sys/devices/system/node/node%lu/cpulist"
+
+int worker_cpu_count = 0;
+
+static int *worker_cpus = NULL;		// The allowed CPUs in ascending order
+static cpu_set_t allowed;
+static bool restricted = false;
+
+/*
+ * Parse a Linux CPU or node list such as "0-3,8,10-11" into a set, calling
+ * add for each member. Returns false on a malformed list.
+ */
+static bool parse_list(const char *list, bool (*add)(unsigned long item, cpu_set_t *set), cpu_set_t *set) {
+	unsigned long first, last;
+	char *end;
+
+	while (isspace((unsigned char) *list))
+		list++;
+	if (*list == '\0')
+		return false;
+	for (;;) {
+		if (!isdigit((unsigned char) *list))
+			return false;
+		first = last = strtoul(list, &end, 10);
+		if (*end == '-') {
+			if (!isdigit((unsigned char) end[1]))
+				return false;
+			last = strtoul(end + 1, &end, 10);
+		}
+		if (last < first)
+			return false;
+		for (; first <= last; first++) {
+			if (!add(first, set))
+				return false;
+		}
+		while (isspace((unsigned char) *end))
+			end++;
+		if (*end == '\0')
+			return true;
+		if (*end != ',')
+			return false;
+		list = end + 1;
+	}
+}
+
+static bool add_cpu(unsigned long cpu, cpu_set_t *set) {
+	if (cpu >= CPU_SETSIZE)
+		return false;
+	CPU_SET(cpu, set);
+	return true;
+}
+
+static bool add_node(unsigned long node, cpu_set_t *set) {
+	char path[64], line[4096];
+	FILE *file;
+	bool result;
+
+	snprintf(path, sizeof(path), NODE_CPULIST, node);
+	if (!(file = fopen(path, "r")))
+		return false;
+	result = fgets(line, sizeof(line), file) && parse_list(line, add_cpu, set);
+	fclose(file);
+	return result;
+}
+
+static void restrict_to(cpu_set_t *set) {
+	if (restricted)
+		CPU_AND(&allowed, &allowed, set);
+	else
+		allowed = *set;
+	restricted = true;
+}
+
+/**
+ * Confine workers to a list of CPUs, as given to --cpus.
+ *
+ * @param list: CPU numbers and ranges, such as "0-7,16-23".
+ * @return false if the list is malformed
+ */
+bool restrict_to_cpus(const char *list) {
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	if (!parse_list(list, add_cpu, &set)) {
+		fprintf(stderr, "Invalid --cpus list: %s\n", list);
+		return false;
+	}
+	restrict_to(&set);
+	return true;
+}
+
+/**
+ * Confine workers to the CPUs of some NUMA nodes, as given to --numa.
+ *
+ * Given with --cpus as well, only CPUs in both lists are used.
+ *
+ * @param list: Node numbers and ranges, such as "1" or "0-1".
+ * @return false if the list is malformed or names a node that does not exist
+ */
+bool restrict_to_nodes(const char *list) {
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	if (!parse_list(list, add_node, &set)) {
+		fprintf(stderr, "Invalid --numa node list: %s\n", list);
+		return false;
+	}
+	restrict_to(&set);
+	return true;
+}
+
+/**
+ * Confine the whole process to the chosen CPUs, so threads that are not
+ * pinned, like the batch reader and writer, stay on them too.
+ *
+ * @return false if no chosen CPU is available to the process
+ */
+bool apply_affinity(void) {
+	int cpu;
+
+	if (!restricted)
+		return true;
+	if (CPU_COUNT(&allowed) == 0 || sched_setaffinity(0, sizeof(allowed), &allowed) != 0) {
+		fprintf(stderr, "None of the chosen CPUs is available.\n");
+		return false;
+	}
+
+	// The kernel drops CPUs that are offline or outside our cpuset
+	sched_getaffinity(0, sizeof(allowed), &allowed);
+	worker_cpus = (int *) malloc(CPU_COUNT(&allowed) * sizeof(int));
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (CPU_ISSET(cpu, &allowed))
+			worker_cpus[worker_cpu_count++] = cpu;
+	}
+	return true;
+}
+
+/**
+ * Pin the calling thread to the CPU for a worker, if CPUs were chosen.
+ *
+ * Workers beyond the number of CPUs wrap around to the first one again.
+ * Call it before the worker allocates its state, so the pages land on the
+ * worker's node.
+ *
+ * @param index: The worker's number within its pool.
+ */
+void pin_worker(int index) {
+	cpu_set_t set;
+
+	if (!worker_cpu_count)
+		return;
+	CPU_ZERO(&set);
+	CPU_SET(worker_cpus[index % worker_cpu_count], &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
@@ -0,0 +1,41 @@
+/******************************************************************************
+ * CPU and NUMA placement of worker threads.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef AFFINITY_H
+#define AFFINITY_H 1
+
+#include "rhoTypes.h"
+
+/*
+ * With --cpus or --numa, the process is confined to the chosen CPUs and each
+ * worker pins itself to one of them, in order, before it allocates anything.
+ * Linux places pages on the node of the thread that first touches them, so
+ * the walk state, kernel and GMP temporaries of a pinned worker stay on its
+ * own node and never follow a migration to another socket.
+ */
+extern int worker_cpu_count;		// CPUs workers are pinned to, or 0 if they float
+
+bool restrict_to_cpus(const char *list);
+bool restrict_to_nodes(const char *list);
+bool apply_affinity(void);
+void pin_worker(int index);
+
+#endif // AFFINITY_H
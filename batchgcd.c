@@ -0,0 +1,151 @@
+/******************************************************************************
+ * Batch GCD over a list of composites.
+ *
+ * Bernstein's product and remainder trees find, for every number in a list,
+ * its GCD with the product of all the others in quasi-linear time, exposing
+ * every factor shared between inputs without any rho work.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#include <stdlib.h>
+
+#include <gmp.h>
+
+#include "batchgcd.h"
+
+static mpz_t *alloc_level(size_t count) {
+	mpz_t *level = (mpz_t *) malloc(count * sizeof(mpz_t));
+	size_t i;
+
+	for (i = 0; i < count; i++)
+		mpz_init(level[i]);
+	return level;
+}
+
+static void free_level(mpz_t *level, size_t count) {
+	size_t i;
+
+	for (i = 0; i < count; i++)
+		mpz_clear(level[i]);
+	free(level);
+}
+
+/**
+ * Compute gcd(n_i, product of all n_j with j != i) for every i.
+ *
+ * Numbers below 2 take no part and get a GCD of 1.
+ *
+ * @param gcds: Initialized outputs, one per number.
+ * @param numbers: The numbers.
+ * @param count: How many numbers there are.
+ */
+void batch_gcd(mpz_t *gcds, mpz_t *numbers, size_t count) {
+	mpz_t **tree;
+	size_t *sizes, levels, level, i;
+
+	for (i = 0; i < count; i++)
+		mpz_set_ui(gcds[i], 1);
+	if (count == 0)
+		return;
+
+	// Product tree: leaves are the numbers, each node the product of its children
+	for (levels = 1, i = count; i > 1; i = (i + 1) / 2)
+		levels++;
+	tree = (mpz_t **) malloc(levels * sizeof(mpz_t *));
+	sizes = (size_t *) malloc(levels * sizeof(size_t));
+
+	sizes[0] = count;
+	tree[0] = alloc_level(count);
+	for (i = 0; i < count; i++) {
+		if (mpz_cmp_ui(numbers[i], 1) > 0)
+			mpz_set(tree[0][i], numbers[i]);
+		else
+			mpz_set_ui(tree[0][i], 1);
+	}
+	for (level = 1; level < levels; level++) {
+		sizes[level] = (sizes[level - 1] + 1) / 2;
+		tree[level] = alloc_level(sizes[level]);
+		for (i = 0; i < sizes[level]; i++) {
+			if (2 * i + 1 < sizes[level - 1])
+				mpz_mul(tree[level][i], tree[level - 1][2 * i], tree[level - 1][2 * i + 1]);
+			else
+				mpz_set(tree[level][i], tree[level - 1][2 * i]);
+		}
+	}
+
+	// Remainder tree: reduce the product modulo the square of every node in place
+	for (level = levels - 1; level-- > 0; ) {
+		for (i = 0; i < sizes[level]; i++) {
+			mpz_t *node = &tree[level][i];
+			mpz_t square;
+
+			mpz_init(square);
+			mpz_mul(square, *node, *node);
+			mpz_mod(square, tree[level + 1][i / 2], square);
+			if (level == 0) {
+				// P mod n^2 is n times (P/n mod n)
+				mpz_divexact(square, square, *node);
+				mpz_gcd(gcds[i], square, *node);
+			} else {
+				mpz_swap(*node, square);
+			}
+			mpz_clear(square);
+		}
+		// Parents are no longer needed once all their children are reduced
+		free_level(tree[level + 1], sizes[level + 1]);
+	}
+	free_level(tree[0], sizes[0]);
+
+	for (i = 0; i < count; i++) {
+		if (mpz_cmp_ui(numbers[i], 1) <= 0)
+			mpz_set_ui(gcds[i], 1);
+	}
+	free(tree);
+	free(sizes);
+}
+
+/**
+ * Turn a batch GCD result into a proper factor of one number.
+ *
+ * When every prime of n_i is shared the batch GCD is n_i itself, so fall back
+ * to pairwise GCDs with the other numbers that share something.
+ *
+ * @param factor: Receives a proper factor of n_i, or 1 if there is none.
+ * @param gcds: The results of batch_gcd().
+ * @param numbers: The numbers passed to batch_gcd().
+ * @param count: How many numbers there are.
+ * @param i: The number to split.
+ */
+void split_shared(mpz_t factor, mpz_t *gcds, mpz_t *numbers, size_t count, size_t i) {
+	size_t j;
+
+	mpz_set(factor, gcds[i]);
+	if (mpz_cmp(factor, numbers[i]) != 0)
+		return;
+
+	mpz_set_ui(factor, 1);
+	for (j = 0; j < count; j++) {
+		if (j == i || mpz_cmp_ui(gcds[j], 1) <= 0)
+			continue;
+		mpz_gcd(factor, numbers[i], numbers[j]);
+		if (mpz_cmp_ui(factor, 1) > 0 && mpz_cmp(factor, numbers[i]) < 0)
+			return;
+	}
+	mpz_set_ui(factor, 1);
+}
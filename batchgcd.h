@@ -0,0 +1,32 @@
+/******************************************************************************
+ * Batch GCD over a list of composites.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef BATCHGCD_H
+#define BATCHGCD_H 1
+
+#include <stddef.h>
+
+#include <gmp.h>
+
+void batch_gcd(mpz_t *gcds, mpz_t *numbers, size_t count);
+void split_shared(mpz_t factor, mpz_t *gcds, mpz_t *numbers, size_t count, size_t i);
+
+#endif // BATCHGCD_H
@@ -0,0 +1,279 @@
+/******************************************************************************
+ * Microbenchmarks for the arithmetic behind run_rho.
+ *
+ * Times modular squaring and multiplication (generic mpz path and fixed-limb
+ * kernel), GCD with n, the PRP test, and one full iteration of the rho inner
+ * loop between GCDs, for moduli of
+ * each limb count in a range. Each figure is the mean of several samples with
+ * a 95% confidence interval, in nanoseconds per operation.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <gmp.h>
+
+#include "carg_parser.h"
+#include "rho.h"
+
+typedef enum { OUTPUT_TABLE, OUTPUT_CSV, OUTPUT_JSON } OutputFormat;
+
+typedef struct {
+	mpz_t n, x, y, temp, product, gcd;
+	rho_kernel_t kernel;
+	FinishingState finishingState;
+} bench_t;
+
+typedef void (*bench_op_t)(bench_t *bench, long count);
+
+static int samples = 20;
+static double sample_seconds = 0.01;
+static int min_limbs = 1, max_limbs = 16;
+static OutputFormat output = OUTPUT_TABLE;
+static bool first_result = true;
+
+/*----------------------------- OPERATIONS ------------------------------*/
+
+#if DEBUG
+#define bench_g(b, out, in) g((out), (in), (b)->n, (b)->temp, &(b)->kernel, &(b)->finishingState)
+#else
+#define bench_g(b, out, in) g((out), (in), (b)->n, (b)->temp, &(b)->kernel)
+#endif
+
+static void op_sqr(bench_t *bench, long count) {
+	while (count--)
+		bench_g(bench, bench->x, bench->x);
+}
+
+static void op_mul(bench_t *bench, long count) {
+	while (count--)
+		modular_multiply(bench->product, bench->product, bench->x, bench->n, &bench->kernel);
+}
+
+static void op_gcd(bench_t *bench, long count) {
+	while (count--)
+		mpz_gcd(bench->gcd, bench->y, bench->n);
+}
+
+static void op_prp(bench_t *bench, long count) {
+	while (count--)
+		is_mpz_prp(bench->n);
+}
+
+// One Brent step as run_rho does it inside a GCD block: advance the hare, multiply in |x - y|
+static void op_iteration(bench_t *bench, long count) {
+	while (count--) {
+		bench_g(bench, bench->y, bench->y);
+		absolute_difference(bench->temp, bench->x, bench->y, &bench->kernel);
+		modular_multiply(bench->product, bench->product, bench->temp, bench->n, &bench->kernel);
+	}
+}
+
+/*------------------------------ TIMING ---------------------------------*/
+
+static double now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Two-sided 95% Student t quantiles for 1..30 degrees of freedom
+static double t_quantile(int df) {
+	static const double table[] = { 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365,
+		2.306, 2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101,
+		2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+
+	if (df < 1)
+		return 0;
+	return df <= 30 ? table[df - 1] : 1.96;
+}
+
+/*
+ * Grow the operation count until one sample takes sample_seconds, then take
+ * the samples and report mean and confidence half-width in ns/op.
+ */
+static void measure(bench_t *bench, bench_op_t op, double *mean, double *ci) {
+	double start, elapsed, sum = 0, sum_squares = 0, ns, variance;
+	long count = 1;
+	int i;
+
+	for (;;) {
+		start = now();
+		op(bench, count);
+		elapsed = now() - start;
+		if (elapsed >= sample_seconds || count > (1L << 40))
+			break;
+		count *= elapsed > 0 ? MIN(MAX(2, (long) (sample_seconds / elapsed) + 1), 100) : 100;
+	}
+
+	for (i = 0; i < samples; i++) {
+		start = now();
+		op(bench, count);
+		ns = (now() - start) * 1e9 / count;
+		sum += ns;
+		sum_squares += ns * ns;
+	}
+
+	*mean = sum / samples;
+	variance = samples > 1 ? (sum_squares - sum * sum / samples) / (samples - 1) : 0;
+	*ci = t_quantile(samples - 1) * sqrt(MAX(variance, 0) / samples);
+}
+
+static void report(const char *name, int limbs, bool kernel, double mean, double ci) {
+	switch (output) {
+		case OUTPUT_CSV:
+			if (first_result)
+				printf("benchmark,limbs,kernel,ns_per_op,ci95\n");
+			printf("%s,%d,%d,%.2f,%.2f\n", name, limbs, kernel, mean, ci);
+			break;
+		case OUTPUT_JSON:
+			printf("%s\n  {\"benchmark\": \"%s\", \"limbs\": %d, \"kernel\": %s, "
+				"\"ns_per_op\": %.2f, \"ci95\": %.2f}",
+				first_result ? "[" : ",", name, limbs, kernel ? "true" : "false", mean, ci);
+			break;
+		default:
+			if (first_result)
+				printf("%-10s %5s %6s %14s\n", "benchmark", "limbs", "kernel", "ns/op");
+			printf("%-10s %5d %6s %8.1f ± %.1f\n", name, limbs, kernel ? "yes" : "no", mean, ci);
+			break;
+	}
+	first_result = false;
+}
+
+/*------------------------------- DRIVER --------------------------------*/
+
+static void bench_limbs(gmp_randstate_t random, int limbs) {
+	bench_t bench;
+	double mean, ci;
+	int pass;
+
+	mpz_init(bench.n);
+	mpz_init(bench.x);
+	mpz_init(bench.y);
+	mpz_init(bench.temp);
+	mpz_init(bench.product);
+	mpz_init(bench.gcd);
+
+	// A random odd composite with exactly this many limbs
+	do {
+		mpz_urandomb(bench.n, random, limbs * GMP_NUMB_BITS);
+		mpz_setbit(bench.n, limbs * GMP_NUMB_BITS - 1);
+		mpz_setbit(bench.n, 0);
+	} while (is_mpz_prp(bench.n));
+
+	// Generic path first, then the kernel where one exists for this size
+	for (pass = 0; pass < 2; pass++) {
+		init_kernel(&bench.kernel, bench.n, G_CONSTANT, 2);
+		if (pass == 0) {
+			bench.kernel.map = NULL;
+			bench.kernel.mul = NULL;
+			bench.kernel.diff = NULL;
+			bench.kernel.limbs = 0;
+		} else if (!bench.kernel.map) {
+			clear_kernel(&bench.kernel);
+			break;
+		}
+		mpz_urandomm(bench.x, random, bench.n);
+		mpz_urandomm(bench.y, random, bench.n);
+		mpz_set_ui(bench.product, 1);
+
+		measure(&bench, op_sqr, &mean, &ci);
+		report("sqr", limbs, pass, mean, ci);
+		measure(&bench, op_mul, &mean, &ci);
+		report("mul", limbs, pass, mean, ci);
+		measure(&bench, op_iteration, &mean, &ci);
+		report("iteration", limbs, pass, mean, ci);
+		clear_kernel(&bench.kernel);
+	}
+
+	mpz_urandomm(bench.y, random, bench.n);
+	measure(&bench, op_gcd, &mean, &ci);
+	report("gcd", limbs, false, mean, ci);
+
+	mpz_nextprime(bench.n, bench.n);
+	measure(&bench, op_prp, &mean, &ci);
+	report("prp", limbs, false, mean, ci);
+
+	mpz_clear(bench.n);
+	mpz_clear(bench.x);
+	mpz_clear(bench.y);
+	mpz_clear(bench.temp);
+	mpz_clear(bench.product);
+	mpz_clear(bench.gcd);
+}
+
+/**
+ * Run the benchmarks.
+ *
+ * @param argc: The number of arguments.
+ * @param argv: The array of arguments.
+ * @return 0 on success
+ */
+int main(const int argc, const char * const argv[]) {
+	gmp_randstate_t random;
+	int argind, limbs;
+
+	const struct ap_Option options[] =
+		{
+		{ 'n', "samples",    ap_yes   },	// Samples per benchmark (default: 20)
+		{ 't', "sample-ms",  ap_yes   },	// Target length of one sample (default: 10)
+		{ 'm', "min-limbs",  ap_yes   },	// Smallest modulus, in limbs (default: 1)
+		{ 'M', "max-limbs",  ap_yes   },	// Largest modulus, in limbs (default: 16)
+		{ 'c', "csv",        ap_no    },	// Machine-readable CSV output
+		{ 'j', "json",       ap_no    } };	// Machine-readable JSON output
+
+	struct Arg_parser parser;
+	if (!ap_init(&parser, argc, argv, options, false) || ap_error(&parser)) {
+		fprintf(stderr, "%s\n", ap_error(&parser) ? ap_error(&parser) : "Out of memory");
+		return 1;
+	}
+
+	for (argind = 0; argind < ap_arguments(&parser); ++argind) {
+		const int code = ap_code(&parser, argind);
+		const char * const arg = ap_argument(&parser, argind);
+		switch (code) {
+			case 'n': samples = strtol(arg, NULL, 10); break;
+			case 't': sample_seconds = strtod(arg, NULL) / 1000; break;
+			case 'm': min_limbs = strtol(arg, NULL, 10); break;
+			case 'M': max_limbs = strtol(arg, NULL, 10); break;
+			case 'c': output = OUTPUT_CSV; break;
+			case 'j': output = OUTPUT_JSON; break;
+		}
+	}
+	ap_free(&parser);
+
+	if (samples < 2 || min_limbs < 1 || max_limbs < min_limbs) {
+		fprintf(stderr, "Need at least 2 samples and 1 <= min-limbs <= max-limbs.\n");
+		return 1;
+	}
+
+	gmp_randinit_default(random);
+	gmp_randseed_ui(random, 1);
+	for (limbs = min_limbs; limbs <= max_limbs; limbs++)
+		bench_limbs(random, limbs);
+	gmp_randclear(random);
+
+	if (output == OUTPUT_JSON)
+		printf("\n]\n");
+	return 0;
+}
@@ -4,7 +4,7 @@
  * This version does not skip indices k for 2^i < k < 3*2^(i-1), as suggested
  * by Brent in his paper. This is an oversight corrected in brent2.c.
  *
- * Copyright 2017, 2021, Alexander Jones.
+ * Copyright 2017, 2021, 2026, Alexander Jones.
  *
  * Based on code from yafu, which has been placed into the public domain by its
  * author, Ben Buhrow.
@@ -25,58 +25,130 @@
  * Boston, MA 02110-1301, USA.
  ******************************************************************************/
 
+#include "control.h"
+#include "perf.h"
+#include "resume.h"
 #include "rho.h"
+#include "schedule.h"
+#include "trace.h"
+
+const char engine_name[] = "brent1";
 
 FinishingState run_rho(fact_obj_t *fobj) {
 	uint32 c = fobj->rho_obj.curr_poly;
-	mpz_t x, y, product, curr_gcd, temp, f;
+	uint32 *polys = fobj->rho_obj.polynomials;
+	mpz_t x, y, y_start, product, curr_gcd, temp, f;
+	rho_kernel_t kernel;
+	gcd_schedule_t schedule;
 
-	uint32_t i, skip_counter, power;
-	int iterations;
+	uint32_t i, skip_counter, skip_start, power;
+	int iterations, block_start, calls_start;
+	bool stopped = false;
 	FinishingState finishingState = {0, 0, 0};
 
 	// Initialize local bigints
 	mpz_init(x);				// "Tortoise"
-	mpz_init_set_ui(y, X_0);		// "Hare"
+	mpz_init_set(y, fobj->rho_obj.start);	// "Hare"
 	mpz_init(temp);				// Temporary storage
 	mpz_init(f);				// Found factor
-	mpz_init_set_ui(constant, polys[c]);	// Constant in polynomial
+	init_kernel(&kernel, fobj->rho_obj.gmp_n, polys[c], fobj->rho_obj.exponent);	// Iteration map, kernel for n
 	mpz_init_set_ui(curr_gcd, 1);		// Current GCD
+	mpz_init_set_ui(product, 1);		// Product of differences since the last GCD
+	mpz_init(y_start);			// Hare at the start of the block
+	trace_event(TRACE_START, polys[c], 0, fobj->rho_obj.gmp_n, y, NULL);
+	kernel_enter(&kernel, y, fobj->rho_obj.gmp_n);
+	init_gcd_schedule(&schedule, &kernel, fobj->rho_obj.gmp_n);
 
 	// Starting state of algorithm
 	power = 1;				// Current power of two
 	i = 0;					// Loop counter
 	iterations = 0;				// Rho iteration count
+	block_start = skip_start = calls_start = 0;	// Counts at the start of the block
+
+	// Carry on a stored walk: mid-round with its tortoise, or from the next round
+	if (resume_walk(fobj, &kernel, x, y)) {
+		iterations = block_start = fobj->rho_obj.walk.iterations;
+		power = fobj->rho_obj.walk.power;
+		skip_counter = fobj->rho_obj.walk.position;
+		if (skip_counter < power)
+			goto resume;
+		power *= 2;
+	}
 
 	do {
 		mpz_set(x, y);
 
 		skip_counter = 0;
+resume:
 		do {
+			if (schedule.pending == 0) {
+				mpz_set(y_start, y);
+				block_start = iterations;
+				calls_start = finishingState.function_calls;
+				skip_start = skip_counter;
+			}
+
 			square(y, y);
 
-			mpz_sub(temp, x, y); //q = q*abs(x-y) mod n
-			mpz_abs(temp, temp);
-			mpz_gcd(curr_gcd, temp, fobj->rho_obj.gmp_n);
+			difference(temp, x, y);
+			multiply(product, product, temp); //q = q*abs(x-y) mod n
 			iterations++;
+			trace_step(polys[c], iterations, x, y, &kernel);
 			skip_counter++;
-		} while (skip_counter < power && mpz_get_ui(curr_gcd) == 1 && iterations < max_iterations);
+
+			// Blocks end with the power of two, so x is the same throughout
+			if (gcd_due(&schedule) || skip_counter >= power || iterations >= fobj->rho_obj.iterations) {
+				perf_begin(PERF_GCD);
+				mpz_gcd(curr_gcd, product, fobj->rho_obj.gmp_n);
+				perf_end(PERF_GCD);
+				trace_gcd(polys[c], iterations, curr_gcd);
+
+				if (mpz_cmp_ui(curr_gcd, 1) != 0 && iterations - block_start > 1) {
+					// Replay a longer block a step at a time to stop where the factor appears
+					perf_begin(PERF_REPLAY);
+					mpz_set(y, y_start);
+					iterations = block_start;
+					finishingState.function_calls = calls_start;
+					skip_counter = skip_start;
+					do {
+						square(y, y);
+
+						difference(temp, x, y);
+						mpz_gcd(curr_gcd, temp, fobj->rho_obj.gmp_n);
+						iterations++;
+						skip_counter++;
+						trace_gcd(polys[c], iterations, curr_gcd);
+					} while (mpz_cmp_ui(curr_gcd, 1) == 0);
+					perf_end(PERF_REPLAY);
+				}
+
+				mpz_set_ui(product, 1);
+				gcd_taken(&schedule);
+				if (check_control(fobj, iterations)) {
+					stopped = true;
+					break;
+				}
+			}
+		} while (skip_counter < power && mpz_get_ui(curr_gcd) == 1 && iterations < fobj->rho_obj.iterations);
 		power *= 2;
-	} while (mpz_get_ui(curr_gcd) == 1 && iterations < max_iterations);
+	} while (mpz_get_ui(curr_gcd) == 1 && iterations < fobj->rho_obj.iterations && !stopped);
 
 	if (mpz_cmp(curr_gcd, fobj->rho_obj.gmp_n) == 0 || mpz_get_ui(curr_gcd) == 1) {
 		mpz_set_ui(f, 0);
 	} else {
 		mpz_set(f, curr_gcd);
 	}
-#if DEBUG
 	finishingState.final_index = iterations;
-#endif
+	if (mpz_cmp_ui(curr_gcd, 1) == 0)
+		keep_walk(fobj, &kernel, x, y, iterations, power / 2, skip_counter);
+	trace_event(TRACE_END, polys[c], iterations, f, NULL, NULL);
 
 free:
 	mpz_clear(x);
 	mpz_clear(y);
-	mpz_clear(constant);
+	clear_kernel(&kernel);
+	mpz_clear(y_start);
+	mpz_clear(product);
 	mpz_clear(temp);
 	mpz_clear(curr_gcd);
 	mpz_set(fobj->rho_obj.gmp_f, f);
@@ -0,0 +1,253 @@
+/******************************************************************************
+ * Factor records with certificates, for checking results downstream.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#include <stdio.h>
+
+#include <gmp.h>
+
+#include "certify.h"
+
+#define TRIAL_LIMIT 1024		// Trial division bound before splitting p - 1 by rho
+#define MAX_PRIME_FACTORS 16		// Distinct primes of a 64-bit number, with room to spare
+
+bool certify_output = false;
+
+/*----------------------------- 64-BIT ARITHMETIC -----------------------------*/
+
+static inline uint64 mulmod64(uint64 a, uint64 b, uint64 m) {
+#ifdef __SIZEOF_INT128__
+	return (uint64) ((unsigned __int128) a * b % m);
+#else
+	uint64 r = 0;
+
+	a %= m;
+	while (b) {
+		if (b & 1)
+			r = r >= m - a ? r - (m - a) : r + a;
+		a = a >= m - a ? a - (m - a) : a + a;
+		b >>= 1;
+	}
+	return r;
+#endif
+}
+
+static uint64 powmod64(uint64 base, uint64 exponent, uint64 m) {
+	uint64 result = 1;
+
+	base %= m;
+	while (exponent) {
+		if (exponent & 1)
+			result = mulmod64(result, base, m);
+		base = mulmod64(base, base, m);
+		exponent >>= 1;
+	}
+	return result;
+}
+
+// Miller-Rabin with the first twelve prime bases, which is exact below 2^64
+static bool is_prime64(uint64 n) {
+	static const uint64 bases[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 };
+	uint64 d = n - 1, x;
+	int s = 0, i, j;
+
+	if (n < 2)
+		return false;
+	for (i = 0; i < 12; i++) {
+		if (n % bases[i] == 0)
+			return n == bases[i];
+	}
+	while ((d & 1) == 0) {
+		d >>= 1;
+		s++;
+	}
+	for (i = 0; i < 12; i++) {
+		x = powmod64(bases[i], d, n);
+		if (x == 1 || x == n - 1)
+			continue;
+		for (j = 1; j < s && x != n - 1; j++)
+			x = mulmod64(x, x, n);
+		if (x != n - 1)
+			return false;
+	}
+	return true;
+}
+
+static uint64 gcd64(uint64 a, uint64 b) {
+	while (b) {
+		uint64 t = a % b;
+
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+// A proper factor of an odd composite n, by Brent's rho
+static uint64 rho64(uint64 n) {
+	uint64 c, x, y, product, g, power, i;
+
+	for (c = 1; ; c++) {
+		y = 2;
+		g = 1;
+		for (power = 1; g == 1; power *= 2) {
+			x = y;
+			for (i = 0; i < power && g == 1; i++) {
+				y = (mulmod64(y, y, n) + c) % n;
+				product = x > y ? x - y : y - x;
+				g = gcd64(product, n);
+			}
+		}
+		if (g != n)
+			return g;
+	}
+}
+
+static void add_prime(uint64 *primes, int *count, uint64 p) {
+	int i, j;
+
+	for (i = 0; i < *count && primes[i] < p; i++)
+		;
+	if (i < *count && primes[i] == p)
+		return;
+	for (j = *count; j > i; j--)
+		primes[j] = primes[j - 1];
+	primes[i] = p;
+	(*count)++;
+}
+
+static void split(uint64 n, uint64 *primes, int *count) {
+	uint64 d;
+
+	if (n == 1)
+		return;
+	if (is_prime64(n)) {
+		add_prime(primes, count, n);
+		return;
+	}
+	d = rho64(n);
+	split(d, primes, count);
+	split(n / d, primes, count);
+}
+
+// The distinct primes of n, in ascending order
+static void distinct_primes(uint64 n, uint64 *primes, int *count) {
+	uint64 p;
+
+	*count = 0;
+	for (p = 2; p < TRIAL_LIMIT && p * p <= n; p += (p == 2 ? 1 : 2)) {
+		if (n % p == 0) {
+			add_prime(primes, count, p);
+			do
+				n /= p;
+			while (n % p == 0);
+		}
+	}
+	split(n, primes, count);
+}
+
+/*------------------------------- CERTIFICATES --------------------------------*/
+
+// Write the Pratt certificate of a prime p >= CERTIFY_SMALL, after those it relies on
+static void write_pratt(FILE *out, uint64 p) {
+	uint64 primes[MAX_PRIME_FACTORS], g;
+	int count, i;
+
+	distinct_primes(p - 1, primes, &count);
+	for (i = 0; i < count; i++) {
+		if (primes[i] >= CERTIFY_SMALL)
+			write_pratt(out, primes[i]);
+	}
+
+	for (g = 2; ; g++) {
+		for (i = 0; i < count && powmod64(g, (p - 1) / primes[i], p) != 1; i++)
+			;
+		if (i == count)
+			break;
+	}
+
+	fprintf(out, "pratt %" PRIu64 " %" PRIu64, p, g);
+	for (i = 0; i < count; i++)
+		fprintf(out, " %" PRIu64, primes[i]);
+	fprintf(out, "\n");
+}
+
+// Classify n, writing any certificate the classification relies on first
+static const char *certify_type(FILE *out, mpz_t n) {
+	uint64 value = 0;
+
+	if (mpz_sizeinbase(n, 2) <= 64) {
+		mpz_export(&value, NULL, -1, sizeof(value), 0, 0, n);
+		if (!is_prime64(value))
+			return "composite";
+		if (value >= CERTIFY_SMALL)
+			write_pratt(out, value);
+		return "prime";
+	}
+	return mpz_probab_prime_p(n, 25) ? "prp" : "composite";
+}
+
+/**
+ * Start the records of a composite.
+ *
+ * @param out: Where to write.
+ * @param composite: The number being factored.
+ */
+void certify_composite(FILE *out, mpz_t composite) {
+	gmp_fprintf(out, "composite %Zd\n", composite);
+}
+
+/**
+ * Write the record of one factor, with its certificate if it has one.
+ *
+ * @param out: Where to write.
+ * @param factor: The factor, once for each time it divides the composite.
+ */
+void certify_factor(FILE *out, mpz_t factor) {
+	const char *type = certify_type(out, factor);
+
+	gmp_fprintf(out, "factor %Zd %s\n", factor, type);
+}
+
+/**
+ * Finish the records of a composite: the cofactor, if any, and the product
+ * of everything written for it.
+ *
+ * @param out: Where to write.
+ * @param fobj: The factorization object, after factoring it.
+ */
+void certify_end(FILE *out, fact_obj_t *fobj) {
+	mpz_t product;
+	uint32 i;
+	int j;
+
+	mpz_init_set(product, fobj->rho_obj.gmp_n);
+	if (mpz_cmp_ui(fobj->rho_obj.gmp_n, 1) > 0) {
+		const char *type = certify_type(out, fobj->rho_obj.gmp_n);
+
+		gmp_fprintf(out, "cofactor %Zd %s\n", fobj->rho_obj.gmp_n, type);
+	}
+	for (i = 0; i < fobj->num_factors; i++) {
+		for (j = 0; j < fobj->fobj_factors[i].count; j++)
+			mpz_mul(product, product, fobj->fobj_factors[i].factor);
+	}
+	gmp_fprintf(out, "product %Zd\n", product);
+	mpz_clear(product);
+}
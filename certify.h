@@ -0,0 +1,56 @@
+/******************************************************************************
+ * Factor records with certificates, for checking results downstream.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef CERTIFY_H
+#define CERTIFY_H 1
+
+#include <stdio.h>
+
+#include <gmp.h>
+
+#include "rhoTypes.h"
+
+/*
+ * With --certify, each composite is written as a block of records that a
+ * consumer can check without searching for anything:
+ *
+ *   composite N
+ *   pratt Q G Q1 Q2 ...	Pratt certificate for a prime Q used below
+ *   factor P prime|prp|composite	once per time P divides N, as found
+ *   cofactor M prime|prp|composite	what is left, if it is not 1
+ *   product X			the factors times the cofactor
+ *
+ * A block is good when X = N. A pratt record says Q - 1 has exactly the
+ * distinct prime factors Q1, Q2, ..., G^(Q-1) = 1 mod Q and G^((Q-1)/Qi) != 1
+ * mod Q for each i, which proves Q prime once every Qi is. Every prime below
+ * 2^64 that is marked prime has one, written before the records that rely on
+ * it; primes below CERTIFY_SMALL need none, since trial division settles them.
+ * Larger primes are marked prp and left to the consumer's own test.
+ */
+#define CERTIFY_SMALL 65536
+
+extern bool certify_output;		// Write certified records instead of plain factors
+
+void certify_composite(FILE *out, mpz_t composite);
+void certify_factor(FILE *out, mpz_t factor);
+void certify_end(FILE *out, fact_obj_t *fobj);
+
+#endif // CERTIFY_H
@@ -0,0 +1,133 @@
+/******************************************************************************
+ * Progress reports, time budgets, and early stops driven by signals.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <gmp.h>
+
+#include "control.h"
+
+volatile sig_atomic_t stop_requested = 0;
+volatile sig_atomic_t progress_requested = 0;
+double time_limit = 0;
+double cpu_limit = 0;
+
+#ifdef CLOCK_MONOTONIC_COARSE
+#define BUDGET_CLOCK CLOCK_MONOTONIC_COARSE
+#else
+#define BUDGET_CLOCK CLOCK_MONOTONIC
+#endif
+
+static double read_clock(clockid_t clock) {
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void request_stop(int signal) {
+	stop_requested = signal;
+}
+
+static void request_progress(int signal) {
+	progress_requested = 1;
+}
+
+/**
+ * Install the SIGUSR1, SIGINT and SIGTERM handlers.
+ */
+void install_control_handlers(void) {
+	struct sigaction action;
+
+	// Restart interrupted I/O so a report never costs output
+	memset(&action, 0, sizeof(action));
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+
+	action.sa_handler = request_progress;
+	sigaction(SIGUSR1, &action, NULL);
+
+	action.sa_handler = request_stop;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+}
+
+/**
+ * Monotonic time for walk timing.
+ *
+ * @return Seconds since an arbitrary fixed point
+ */
+double control_clock(void) {
+	return read_clock(CLOCK_MONOTONIC);
+}
+
+/**
+ * CPU time used by the calling thread.
+ *
+ * @return Seconds of CPU time
+ */
+double thread_cpu_clock(void) {
+	return read_clock(CLOCK_THREAD_CPUTIME_ID);
+}
+
+/**
+ * Print the state of the current walk and the factors found so far to stderr.
+ *
+ * @param fobj: The factorization object; rho_obj.ttime holds the walk's start.
+ * @param index: The walk's current index.
+ */
+void report_progress(fact_obj_t *fobj, uint64 index) {
+	double elapsed = control_clock() - fobj->rho_obj.ttime;
+	uint32 i;
+
+	progress_requested = 0;
+	gmp_fprintf(stderr, "Progress: %Zd, polynomial x^%u+%u, index %llu, %.0f iterations/sec\n",
+		fobj->rho_obj.gmp_n, fobj->rho_obj.exponent, fobj->rho_obj.polynomials[fobj->rho_obj.curr_poly],
+		(unsigned long long) index, elapsed > 0 ? index / elapsed : 0.0);
+	for (i = 0; i < fobj->num_factors; i++)
+		gmp_fprintf(stderr, "Found: %Zd^%d\n", fobj->fobj_factors[i].factor, fobj->fobj_factors[i].count);
+}
+
+/**
+ * Start the time budget for one composite.
+ *
+ * @param fobj: The factorization object to set the deadlines in.
+ * @param wall: Wall-clock seconds allowed, or 0 for no limit.
+ * @param cpu: CPU seconds allowed to this thread, or 0 for no limit.
+ */
+void start_budget(fact_obj_t *fobj, double wall, double cpu) {
+	fobj->rho_obj.deadline = wall > 0 ? read_clock(BUDGET_CLOCK) + wall : 0;
+	fobj->rho_obj.cpu_deadline = cpu > 0 ? thread_cpu_clock() + cpu : 0;
+}
+
+/**
+ * Check the deadlines set by start_budget().
+ *
+ * @param fobj: The factorization object.
+ * @return true if either deadline has passed
+ */
+bool budget_exhausted(fact_obj_t *fobj) {
+	if (fobj->rho_obj.deadline > 0 && read_clock(BUDGET_CLOCK) >= fobj->rho_obj.deadline)
+		return true;
+	return fobj->rho_obj.cpu_deadline > 0 && thread_cpu_clock() >= fobj->rho_obj.cpu_deadline;
+}
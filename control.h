@@ -0,0 +1,66 @@
+/******************************************************************************
+ * Progress reports, time budgets, and early stops driven by signals.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef CONTROL_H
+#define CONTROL_H 1
+
+#include <signal.h>
+
+#include "rhoTypes.h"
+
+/*
+ * The handlers only set flags; the walks look at them at each GCD. SIGUSR1
+ * prints a progress report to stderr, and SIGINT or SIGTERM end the walk and
+ * every remaining polynomial and batch entry, so the factors found so far are
+ * still printed.
+ *
+ * A time budget covers one composite across all its polynomials. The walks
+ * check it at the same GCD boundaries, against the coarse monotonic clock for
+ * wall time and the thread's CPU clock for CPU time.
+ */
+extern volatile sig_atomic_t stop_requested;		// Number of the stopping signal, or 0
+extern volatile sig_atomic_t progress_requested;
+extern double time_limit;				// Wall seconds per composite, or 0
+extern double cpu_limit;				// CPU seconds per composite, or 0
+
+void install_control_handlers(void);
+double control_clock(void);
+double thread_cpu_clock(void);
+void report_progress(fact_obj_t *fobj, uint64 index);
+void start_budget(fact_obj_t *fobj, double wall, double cpu);
+bool budget_exhausted(fact_obj_t *fobj);
+
+static inline bool out_of_budget(fact_obj_t *fobj) {
+	return (fobj->rho_obj.deadline > 0 || fobj->rho_obj.cpu_deadline > 0) && budget_exhausted(fobj);
+}
+
+static inline void check_progress(fact_obj_t *fobj, uint64 index) {
+	if (progress_requested)
+		report_progress(fobj, index);
+}
+
+/* Called at each GCD boundary with the walk's current index; true if the walk must end. */
+static inline bool check_control(fact_obj_t *fobj, uint64 index) {
+	check_progress(fobj, index);
+	return stop_requested || out_of_budget(fobj);
+}
+
+#endif // CONTROL_H
@@ -22,6 +22,7 @@ code to the public domain.
 #define _FACTOR_H_
 
 //support libraries
+#include <stdio.h>
 #include <gmp.h>
 #include "types.h"
 #include "rhoTypes.h"
@@ -35,6 +36,7 @@ void alloc_factobj(fact_obj_t *fobj);
 //yafu
 void add_to_factor_list(fact_obj_t *fobj, mpz_t n, FinishingState finishingState);
 void print_factors(fact_obj_t *fobj);
+void fprint_factors(FILE *out, fact_obj_t *fobj);
 void clear_factor_list(fact_obj_t *fobj);
 void delete_from_factor_list(fact_obj_t *fobj, mpz_t n);
 
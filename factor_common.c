@@ -29,6 +29,7 @@ code to the public domain.
 ----------------------------------------------------------------------*/
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "factor.h"
 
@@ -40,6 +41,13 @@ void init_factobj(fact_obj_t *fobj)
 	// initialize stuff for rho
 	fobj->rho_obj.iterations = MAX_ITERATIONS;
 	fobj->rho_obj.curr_poly = 0;
+	fobj->rho_obj.walk_seed = 0;
+	fobj->rho_obj.walk.iterations = 0;
+	fobj->rho_obj.exponent = 2;
+	fobj->rho_obj.deadline = 0;
+	fobj->rho_obj.cpu_deadline = 0;
+
+	fobj->factor_stream = NULL;
 }
 
 void free_factobj(fact_obj_t *fobj)
@@ -48,9 +56,14 @@ void free_factobj(fact_obj_t *fobj)
 	free(fobj->rho_obj.polynomials);
 	mpz_clear(fobj->rho_obj.gmp_n);
 	mpz_clear(fobj->rho_obj.gmp_f);
+	mpz_clear(fobj->rho_obj.start);
+	mpz_clear(fobj->rho_obj.walk.x);
+	mpz_clear(fobj->rho_obj.walk.y);
 
 	clear_factor_list(fobj);
 	free(fobj->fobj_factors);
+	free(fobj->fobj_factor_info);
+	free(fobj->factor_hash);
 }
 
 void alloc_factobj(fact_obj_t *fobj)
@@ -64,9 +77,13 @@ void alloc_factobj(fact_obj_t *fobj)
 	}
 	mpz_init(fobj->rho_obj.gmp_n);
 	mpz_init(fobj->rho_obj.gmp_f);
+	mpz_init(fobj->rho_obj.start);
+	mpz_init(fobj->rho_obj.walk.x);
+	mpz_init(fobj->rho_obj.walk.y);
 
 	fobj->allocated_factors = 8;
 	fobj->fobj_factors = (factor_t *)malloc(8 * sizeof(factor_t));
+	fobj->fobj_factor_info = (factor_info_t *)malloc(8 * sizeof(factor_info_t));
 	for (i = 0; i < fobj->allocated_factors; i++)
 	{
 		fobj->fobj_factors[i].type = UNKNOWN;
@@ -75,6 +92,9 @@ void alloc_factobj(fact_obj_t *fobj)
 
 	fobj->num_factors = 0;
 
+	fobj->hash_size = 16;
+	fobj->factor_hash = (uint32 *)calloc(fobj->hash_size, sizeof(uint32));
+
 	return;
 }
 
@@ -86,77 +106,138 @@ int is_mpz_prp(mpz_t n)
 	return mpz_probab_prime_p(n, 25);
 }
 
+/*
+ * The factor hash is keyed on the low limb and the size of each factor, which
+ * is plenty to tell factors apart; collisions fall back to mpz_cmp.
+ */
+static uint32 hash_factor(mpz_t n)
+{
+	uint64 h = (uint64)mpz_getlimbn(n, 0) ^ ((uint64)mpz_size(n) << 56);
+
+	h *= 0x9e3779b97f4a7c15ULL;
+	return (uint32)(h >> 32);
+}
+
+//find the hash slot holding n, or the empty slot where it would go
+static uint32 find_slot(fact_obj_t *fobj, mpz_t n)
+{
+	uint32 mask = fobj->hash_size - 1;
+	uint32 slot = hash_factor(n) & mask;
+
+	while (fobj->factor_hash[slot] != 0 &&
+		mpz_cmp(n, fobj->fobj_factors[fobj->factor_hash[slot] - 1].factor) != 0)
+	{
+		slot = (slot + 1) & mask;
+	}
+
+	return slot;
+}
+
+static void rebuild_factor_hash(fact_obj_t *fobj, uint32 hash_size)
+{
+	uint32 i;
+
+	free(fobj->factor_hash);
+	fobj->hash_size = hash_size;
+	fobj->factor_hash = (uint32 *)calloc(hash_size, sizeof(uint32));
+	for (i = 0; i < fobj->num_factors; i++)
+	{
+		fobj->factor_hash[find_slot(fobj, fobj->fobj_factors[i].factor)] = i + 1;
+	}
+}
+
 void add_to_factor_list(fact_obj_t *fobj, mpz_t n, FinishingState finishingState)
 {
 	//stick the number n into the global factor list
-	uint32 i;
-	int found = 0, v = 0;
+	uint32 slot, i;
+
+	//look to see if this factor is already in the list
+	slot = find_slot(fobj, n);
+	if (fobj->factor_hash[slot] != 0)
+	{
+		fobj->fobj_factors[fobj->factor_hash[slot] - 1].count++;
+		return;
+	}
 
 	if (fobj->num_factors >= fobj->allocated_factors)
 	{
 		fobj->allocated_factors *= 2;
 		fobj->fobj_factors = (factor_t *)realloc(fobj->fobj_factors,
 			fobj->allocated_factors * sizeof(factor_t));
-	}
-
-	//look to see if this factor is already in the list
-	for (i=0; i < fobj->num_factors && !found; i++)
-	{
-		if (mpz_cmp(n, fobj->fobj_factors[i].factor) == 0)
-		{
-			found = 1;
-			fobj->fobj_factors[i].count++;
-			return;
-		}
+		fobj->fobj_factor_info = (factor_info_t *)realloc(fobj->fobj_factor_info,
+			fobj->allocated_factors * sizeof(factor_info_t));
 	}
 
 	//else, put it in the list
-	mpz_init(fobj->fobj_factors[fobj->num_factors].factor);
-	mpz_set(fobj->fobj_factors[fobj->num_factors].factor, n);
-	fobj->fobj_factors[fobj->num_factors].count = 1;
+	i = fobj->num_factors;
+	mpz_init_set(fobj->fobj_factors[i].factor, n);
+	fobj->fobj_factors[i].count = 1;
 	if (is_mpz_prp(n))
 	{
 		if (mpz_cmp_ui(n, 100000000) < 0)
-			fobj->fobj_factors[fobj->num_factors].type = PRIME;
+			fobj->fobj_factors[i].type = PRIME;
 		else
-			fobj->fobj_factors[fobj->num_factors].type = PRP;
+			fobj->fobj_factors[i].type = PRP;
 	}
 	else
-		fobj->fobj_factors[fobj->num_factors].type = COMPOSITE;
+		fobj->fobj_factors[i].type = COMPOSITE;
 
-	fobj->fobj_factors[fobj->num_factors].finishingState = finishingState;
-	fobj->fobj_factors[fobj->num_factors].polynomial = fobj->rho_obj.curr_poly;
+	fobj->fobj_factor_info[i].finishingState = finishingState;
+	fobj->fobj_factor_info[i].polynomial = fobj->rho_obj.curr_poly;
+	fobj->fobj_factor_info[i].seed = fobj->rho_obj.walk_seed;
 	fobj->num_factors++;
 
+	//keep the table at most half full
+	fobj->factor_hash[slot] = i + 1;
+	if (2 * fobj->num_factors > fobj->hash_size)
+		rebuild_factor_hash(fobj, 2 * fobj->hash_size);
+
 	return;
 }
 
 void delete_from_factor_list(fact_obj_t *fobj, mpz_t n)
 {
 	//remove the number n from the global factor list
-	uint32 i;
+	uint32 mask = fobj->hash_size - 1;
+	uint32 slot, next, home, i, last;
 
 	//find the factor
-	for (i=0;i<fobj->num_factors; i++)
+	slot = find_slot(fobj, n);
+	if (fobj->factor_hash[slot] == 0)
+		return;
+	i = fobj->factor_hash[slot] - 1;
+	last = fobj->num_factors - 1;
+
+	//empty its slot, shifting back any later entry of the probe run that
+	//would otherwise become unreachable
+	fobj->factor_hash[slot] = 0;
+	for (next = (slot + 1) & mask; fobj->factor_hash[next] != 0; next = (next + 1) & mask)
 	{
-		if (mpz_cmp(n,fobj->fobj_factors[i].factor) == 0)
+		home = hash_factor(fobj->fobj_factors[fobj->factor_hash[next] - 1].factor) & mask;
+		if (((next - home) & mask) >= ((next - slot) & mask))
 		{
-			int j;
-			// copy everything above this in the list back one position
-			for (j=i; j<fobj->num_factors-1; j++)
-			{
-				mpz_set(fobj->fobj_factors[j].factor, fobj->fobj_factors[j+1].factor);
-				fobj->fobj_factors[j].count = fobj->fobj_factors[j+1].count;
-			}
-			// remove the last one in the list
-			fobj->fobj_factors[j].count = 0;
-			mpz_clear(fobj->fobj_factors[j].factor);
-
-			fobj->num_factors--;
-			break;
+			fobj->factor_hash[slot] = fobj->factor_hash[next];
+			fobj->factor_hash[next] = 0;
+			slot = next;
 		}
 	}
 
+	//move the last factor into the hole instead of shifting everything down
+	if (i != last)
+	{
+		fobj->factor_hash[find_slot(fobj, fobj->fobj_factors[last].factor)] = i + 1;
+		mpz_swap(fobj->fobj_factors[i].factor, fobj->fobj_factors[last].factor);
+		fobj->fobj_factors[i].count = fobj->fobj_factors[last].count;
+		fobj->fobj_factors[i].type = fobj->fobj_factors[last].type;
+		fobj->fobj_factor_info[i] = fobj->fobj_factor_info[last];
+	}
+
+	// remove the last one in the list
+	fobj->fobj_factors[last].count = 0;
+	mpz_clear(fobj->fobj_factors[last].factor);
+
+	fobj->num_factors--;
+
 	return;
 }
 
@@ -171,13 +252,19 @@ void clear_factor_list(fact_obj_t *fobj)
 		mpz_clear(fobj->fobj_factors[i].factor);
 	}
 	fobj->num_factors = 0;
+	memset(fobj->factor_hash, 0, fobj->hash_size * sizeof(uint32));
 
 	return;
 }
 
-static void print_factor(fact_obj_t *fobj, factor_t factor);
+static void print_factor(FILE *out, fact_obj_t *fobj, uint32 i);
 
 void print_factors(fact_obj_t *fobj)
+{
+	fprint_factors(stdout, fobj);
+}
+
+void fprint_factors(FILE *out, fact_obj_t *fobj)
 {
 	uint32 i, j;
 
@@ -185,27 +272,33 @@ void print_factors(fact_obj_t *fobj)
 	{
 		for (j = 0; j < fobj->fobj_factors[i].count;j++)
 		{
-			print_factor(fobj, fobj->fobj_factors[i]);
+			print_factor(out, fobj, i);
 		}
 	}
 
 	if (mpz_cmp_ui(fobj->rho_obj.gmp_n, 1) > 0)
 	{
 #if DEBUG
-		gmp_printf("Cofactor: %Zd\n", fobj->rho_obj.gmp_n);
+		gmp_fprintf(out, "Cofactor: %Zd\n", fobj->rho_obj.gmp_n);
 #else
-		gmp_printf("%Zd\n", fobj->rho_obj.gmp_n);
+		gmp_fprintf(out, "%Zd\n", fobj->rho_obj.gmp_n);
 #endif
 	}
 }
 
-static void print_factor(fact_obj_t *fobj, factor_t factor) {
+static void print_factor(FILE *out, fact_obj_t *fobj, uint32 i) {
+	factor_t *factor = &fobj->fobj_factors[i];
 #if DEBUG
-	gmp_printf("Factor: %Zd\n", factor.factor);			// Print the factor
-	printf("Polynomial: x^2+%d\n", fobj->rho_obj.polynomials[factor.polynomial]);	// Print the polynomial used
-	printf("Ending index: %d\n", factor.finishingState.final_index);		// Print the ending index
-	printf("Function calls: %d\n", factor.finishingState.function_calls);		// Print the number of function calls
+	factor_info_t *info = &fobj->fobj_factor_info[i];
+
+	gmp_fprintf(out, "Factor: %Zd\n", factor->factor);			// Print the factor
+	fprintf(out, "Polynomial: x^%u+%u\n", fobj->rho_obj.exponent,
+		fobj->rho_obj.polynomials[info->polynomial]);		// Print the polynomial used
+	if (info->seed)
+		fprintf(out, "Walk seed: %" PRIu64 "\n", info->seed);		// Print the seed of the walk
+	fprintf(out, "Ending index: %d\n", info->finishingState.final_index);		// Print the ending index
+	fprintf(out, "Function calls: %d\n", info->finishingState.function_calls);		// Print the number of function calls
 #else
-	gmp_printf("%Zd\n", factor.factor);			// Print the factor
+	gmp_fprintf(out, "%Zd\n", factor->factor);			// Print the factor
 #endif
 }
@@ -1,7 +1,7 @@
 /******************************************************************************
  * Pollard's rho algorithm using Floyd's cycle-finding algorithm.
  *
- * Copyright 2017, 2021, Alexander Jones.
+ * Copyright 2017, 2021, 2026, Alexander Jones.
  *
  * Based on code from yafu, which has been placed into the public domain by its
  * author, Ben Buhrow.
@@ -22,53 +22,120 @@
  * Boston, MA 02110-1301, USA.
  ******************************************************************************/
 
+#include "control.h"
+#include "perf.h"
+#include "resume.h"
 #include "rho.h"
+#include "schedule.h"
+#include "trace.h"
+
+const char engine_name[] = "floyd";
 
 FinishingState run_rho(fact_obj_t *fobj) {
 	uint32 c = fobj->rho_obj.curr_poly;
-	mpz_t x, y, curr_gcd, temp, f;
+	uint32 *polys = fobj->rho_obj.polynomials;
+	mpz_t x, y, x_start, y_start, product, curr_gcd, temp, f;
+	rho_kernel_t kernel;
+	gcd_schedule_t schedule;
 
 	uint32_t i, skip_counter, power;
-	int iterations;
+	int iterations, block_start, calls_start;
 	FinishingState finishingState = {0, 0, 0};
 
 	// Initialize local bigints
-	mpz_init_set_ui(x, X_0);		// "Tortoise"
-	mpz_init_set_ui(y, X_0);		// "Hare"
+	mpz_init_set(x, fobj->rho_obj.start);	// "Tortoise"
+	mpz_init_set(y, fobj->rho_obj.start);	// "Hare"
 	mpz_init(temp);				// Temporary storage
 	mpz_init(f);				// Found factor
-	mpz_init_set_ui(constant, polys[c]);	// Constant in polynomial
+	init_kernel(&kernel, fobj->rho_obj.gmp_n, polys[c], fobj->rho_obj.exponent);	// Iteration map, kernel for n
 	mpz_init_set_ui(curr_gcd, 1);		// Current GCD
+	mpz_init_set_ui(product, 1);		// Product of differences since the last GCD
+	mpz_init(x_start);			// Walk state at the start of the block
+	mpz_init(y_start);
+	trace_event(TRACE_START, polys[c], 0, fobj->rho_obj.gmp_n, y, NULL);
+	kernel_enter(&kernel, x, fobj->rho_obj.gmp_n);
+	kernel_enter(&kernel, y, fobj->rho_obj.gmp_n);
+	init_gcd_schedule(&schedule, &kernel, fobj->rho_obj.gmp_n);
 
 	// Starting state of algorithm
 	iterations = 0;				// Rho iteration count
+	block_start = calls_start = 0;		// Counts at the start of the block
+
+	// Carry on a stored walk
+	if (resume_walk(fobj, &kernel, x, y))
+		iterations = block_start = fobj->rho_obj.walk.iterations;
 
 	do {
+		if (schedule.pending == 0) {
+			mpz_set(x_start, x);
+			mpz_set(y_start, y);
+			block_start = iterations;
+			calls_start = finishingState.function_calls;
+		}
+
 		square(x, x);
 
 		for (i = 0; i < 2; i++) {
 			square(y, y);
 		}
 
-		mpz_sub(temp, x, y);
-		mpz_abs(temp, temp);
-		mpz_gcd(curr_gcd, temp, fobj->rho_obj.gmp_n);
+		difference(temp, x, y);
+		multiply(product, product, temp);
 		iterations++;
-	} while (mpz_get_ui(curr_gcd) == 1 && iterations < max_iterations);
-#if DEBUG
+		trace_step(polys[c], iterations * 2, x, y, &kernel);
+
+		if (gcd_due(&schedule) || iterations >= fobj->rho_obj.iterations) {
+			perf_begin(PERF_GCD);
+			mpz_gcd(curr_gcd, product, fobj->rho_obj.gmp_n);
+			perf_end(PERF_GCD);
+			trace_gcd(polys[c], iterations * 2, curr_gcd);
+
+			if (mpz_cmp_ui(curr_gcd, 1) != 0 && iterations - block_start > 1) {
+				// Replay a longer block a step at a time to stop where the factor appears
+				perf_begin(PERF_REPLAY);
+				mpz_set(x, x_start);
+				mpz_set(y, y_start);
+				iterations = block_start;
+				finishingState.function_calls = calls_start;
+				do {
+					square(x, x);
+
+					for (i = 0; i < 2; i++) {
+						square(y, y);
+					}
+
+					difference(temp, x, y);
+					mpz_gcd(curr_gcd, temp, fobj->rho_obj.gmp_n);
+					iterations++;
+					trace_gcd(polys[c], iterations * 2, curr_gcd);
+				} while (mpz_cmp_ui(curr_gcd, 1) == 0);
+				perf_end(PERF_REPLAY);
+			}
+
+			mpz_set_ui(product, 1);
+			gcd_taken(&schedule);
+			if (check_control(fobj, iterations * 2))
+				break;
+		}
+	} while (mpz_get_ui(curr_gcd) == 1 && iterations < fobj->rho_obj.iterations);
 	finishingState.final_index = iterations * 2;
-#endif
+	if (mpz_cmp_ui(curr_gcd, 1) == 0)
+		keep_walk(fobj, &kernel, x, y, iterations, 0, 0);
 
 	if (mpz_cmp(curr_gcd, fobj->rho_obj.gmp_n) == 0 || mpz_get_ui(curr_gcd) == 1) {
 		mpz_set_ui(f, 0);
 	} else {
 		mpz_set(f, curr_gcd);
 	}
+	trace_event(TRACE_END, polys[c], iterations * 2, f, NULL, NULL);
 
 free:
 	mpz_clear(x);
 	mpz_clear(y);
-	mpz_clear(constant);
+	clear_kernel(&kernel);
+	mpz_clear(x_start);
+	mpz_clear(y_start);
+	mpz_clear(product);
 	mpz_clear(temp);
 	mpz_clear(curr_gcd);
 	mpz_set(fobj->rho_obj.gmp_f, f);
@@ -0,0 +1,206 @@
+/******************************************************************************
+ * Pollard's rho algorithm using Floyd's cycle-finding algorithm, with the
+ * tortoise reading the hare's old values instead of recomputing them.
+ *
+ * The tortoise at step i needs x_i, which the hare passed at step i/2. While
+ * the values in between fit in a ring buffer of FLOYD_RING_BYTES, the hare
+ * leaves each one there and the tortoise copies it out, so a step costs two
+ * map evaluations instead of three. Walks that outgrow the ring fall back to
+ * plain Floyd for the rest of the way; the factors, ending indices and GCD
+ * schedule are the same as floyd's.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * Based on floyd.c, itself based on code from yafu, which has been placed into
+ * the public domain by its author, Ben Buhrow.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#include <stdlib.h>
+
+#include "control.h"
+#include "perf.h"
+#include "resume.h"
+#include "rho.h"
+#include "schedule.h"
+#include "trace.h"
+
+#ifndef FLOYD_RING_BYTES
+#define FLOYD_RING_BYTES (1 << 24)
+#endif
+
+const char engine_name[] = "floyd2";
+
+/*
+ * Slots in the ring for values of the given limb count: a power of two, so
+ * an index maps to its slot with a mask.
+ */
+static uint64 ring_slots(mp_size_t stride) {
+	uint64 slots = 1;
+
+	while (2 * slots * stride * sizeof(mp_limb_t) <= FLOYD_RING_BYTES)
+		slots *= 2;
+	return slots;
+}
+
+// Leave a hare value in its slot, padded to the full stride
+static void ring_store(mp_limb_t *slot, mpz_t value, mp_size_t stride) {
+	mp_size_t size = mpz_size(value);
+
+	mpn_copyi(slot, mpz_limbs_read(value), size);
+	mpn_zero(slot + size, stride - size);
+}
+
+static void ring_load(mpz_t value, const mp_limb_t *slot, mp_size_t stride) {
+	mpn_copyi(mpz_limbs_write(value, stride), slot, stride);
+	mpz_limbs_finish(value, stride);
+}
+
+FinishingState run_rho(fact_obj_t *fobj) {
+	uint32 c = fobj->rho_obj.curr_poly;
+	uint32 *polys = fobj->rho_obj.polynomials;
+	mpz_t x, y, x_start, y_start, product, curr_gcd, temp, f;
+	rho_kernel_t kernel;
+	gcd_schedule_t schedule;
+
+	mp_limb_t *ring;
+	mp_size_t stride;
+	uint64 slots, mask, first, last, hare;
+
+	uint32_t i;
+	int iterations, block_start, calls_start;
+	FinishingState finishingState = {0, 0, 0};
+
+	// Initialize local bigints
+	mpz_init_set(x, fobj->rho_obj.start);	// "Tortoise"
+	mpz_init_set(y, fobj->rho_obj.start);	// "Hare"
+	mpz_init(temp);				// Temporary storage
+	mpz_init(f);				// Found factor
+	init_kernel(&kernel, fobj->rho_obj.gmp_n, polys[c], fobj->rho_obj.exponent);	// Iteration map, kernel for n
+	mpz_init_set_ui(curr_gcd, 1);		// Current GCD
+	mpz_init_set_ui(product, 1);		// Product of differences since the last GCD
+	mpz_init(x_start);			// Walk state at the start of the block
+	mpz_init(y_start);
+	trace_event(TRACE_START, polys[c], 0, fobj->rho_obj.gmp_n, y, NULL);
+	kernel_enter(&kernel, x, fobj->rho_obj.gmp_n);
+	kernel_enter(&kernel, y, fobj->rho_obj.gmp_n);
+	init_gcd_schedule(&schedule, &kernel, fobj->rho_obj.gmp_n);
+
+	// Starting state of algorithm
+	iterations = 0;				// Rho iteration count
+	block_start = calls_start = 0;		// Counts at the start of the block
+
+	// Carry on a stored walk
+	if (resume_walk(fobj, &kernel, x, y))
+		iterations = block_start = fobj->rho_obj.walk.iterations;
+
+	// Hare values x_first .. x_last are in the ring, x_j in slot j & mask
+	stride = mpz_size(kernel.special_bits ? kernel.special : fobj->rho_obj.gmp_n);
+	slots = ring_slots(stride);
+	mask = slots - 1;
+	ring = (mp_limb_t *) malloc(slots * stride * sizeof(mp_limb_t));
+	first = 2 * (uint64) iterations + 1;
+	last = first - 1;
+
+	do {
+		if (schedule.pending == 0) {
+			mpz_set(x_start, x);
+			mpz_set(y_start, y);
+			block_start = iterations;
+			calls_start = finishingState.function_calls;
+		}
+
+		// The hare goes first, so x_(i+1) is in the ring when it is stored at all
+		for (i = 0; i < 2; i++) {
+			square(y, y);
+			hare = 2 * (uint64) iterations + i + 1;
+			if (ring && hare == last + 1 && hare - iterations <= slots && (mp_size_t) mpz_size(y) <= stride) {
+				ring_store(ring + (hare & mask) * stride, y, stride);
+				last = hare;
+			}
+		}
+
+		if (iterations + 1 >= first && iterations + 1 <= last)
+			ring_load(x, ring + ((iterations + 1) & mask) * stride, stride);
+		else
+			square(x, x);
+
+		difference(temp, x, y);
+		multiply(product, product, temp);
+		iterations++;
+		trace_step(polys[c], iterations * 2, x, y, &kernel);
+
+		if (gcd_due(&schedule) || iterations >= fobj->rho_obj.iterations) {
+			perf_begin(PERF_GCD);
+			mpz_gcd(curr_gcd, product, fobj->rho_obj.gmp_n);
+			perf_end(PERF_GCD);
+			trace_gcd(polys[c], iterations * 2, curr_gcd);
+
+			if (mpz_cmp_ui(curr_gcd, 1) != 0 && iterations - block_start > 1) {
+				// Replay a longer block a step at a time to stop where the factor appears
+				perf_begin(PERF_REPLAY);
+				mpz_set(x, x_start);
+				mpz_set(y, y_start);
+				iterations = block_start;
+				finishingState.function_calls = calls_start;
+				do {
+					square(x, x);
+
+					for (i = 0; i < 2; i++) {
+						square(y, y);
+					}
+
+					difference(temp, x, y);
+					mpz_gcd(curr_gcd, temp, fobj->rho_obj.gmp_n);
+					iterations++;
+					trace_gcd(polys[c], iterations * 2, curr_gcd);
+				} while (mpz_cmp_ui(curr_gcd, 1) == 0);
+				perf_end(PERF_REPLAY);
+			}
+
+			mpz_set_ui(product, 1);
+			gcd_taken(&schedule);
+			if (check_control(fobj, iterations * 2))
+				break;
+		}
+	} while (mpz_get_ui(curr_gcd) == 1 && iterations < fobj->rho_obj.iterations);
+	finishingState.final_index = iterations * 2;
+	if (mpz_cmp_ui(curr_gcd, 1) == 0)
+		keep_walk(fobj, &kernel, x, y, iterations, 0, 0);
+
+	if (mpz_cmp(curr_gcd, fobj->rho_obj.gmp_n) == 0 || mpz_get_ui(curr_gcd) == 1) {
+		mpz_set_ui(f, 0);
+	} else {
+		mpz_set(f, curr_gcd);
+	}
+	trace_event(TRACE_END, polys[c], iterations * 2, f, NULL, NULL);
+
+	free(ring);
+
+	mpz_clear(x);
+	mpz_clear(y);
+	clear_kernel(&kernel);
+	mpz_clear(x_start);
+	mpz_clear(y_start);
+	mpz_clear(product);
+	mpz_clear(temp);
+	mpz_clear(curr_gcd);
+	mpz_set(fobj->rho_obj.gmp_f, f);
+	mpz_clear(f);
+
+	return finishingState;
+}
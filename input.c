@@ -0,0 +1,329 @@
+/******************************************************************************
+ * Composite input parsing and batch readers.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gmp.h>
+
+#include "input.h"
+
+/* Base for composites; 0 means decimal unless a 0x/0b prefix says otherwise. */
+int input_base = 0;
+
+/* The value of a digit character in mpz_set_str()'s alphabet, or base if it is not one. */
+static int digit_value(unsigned char c, int base) {
+	int value = base;
+
+	if (c >= '0' && c <= '9')
+		value = c - '0';
+	else if (c >= 'A' && c <= 'Z')
+		value = c - 'A' + 10;
+	else if (c >= 'a' && c <= 'z')
+		value = c - 'a' + (base <= 36 ? 10 : 36);
+	return value < base ? value : base;
+}
+
+/**
+ * Parse a composite given on the command line or in a text batch file.
+ *
+ * Leading and trailing whitespace is ignored. With the default base, a "0x" or
+ * "0b" prefix selects hexadecimal or binary; leading zeros never mean octal.
+ *
+ * @param n: Where to store the parsed value.
+ * @param str: The string to parse.
+ * @return true if str held a valid non-negative integer
+ */
+bool parse_composite(mpz_t n, const char *str) {
+	return parse_composite_token(n, str, strlen(str));
+}
+
+/**
+ * Parse a composite that need not be NUL-terminated, such as a line in a
+ * mapped file, by the same rules as parse_composite().
+ *
+ * The digits are read in place with mpz_set_str()'s grammar: whitespace inside
+ * the number is skipped, and letters are digits above 9.
+ *
+ * @param n: Where to store the parsed value.
+ * @param str: The start of the text.
+ * @param length: The length of the text in bytes.
+ * @return true if the text held a valid non-negative integer
+ */
+bool parse_composite_token(mpz_t n, const char *str, size_t length) {
+	const char *end = str + length;
+	unsigned char stack_digits[256], *digits = stack_digits;
+	size_t count = 0;
+	mp_size_t size;
+	int base = input_base, bits, value;
+	bool negative = false;
+
+	while (str < end && isspace((unsigned char) *str))
+		str++;
+
+	if (base == 0) {
+		base = 10;
+		if (end - str >= 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+			base = 16;
+			str += 2;
+		} else if (end - str >= 2 && str[0] == '0' && (str[1] == 'b' || str[1] == 'B')) {
+			base = 2;
+			str += 2;
+		}
+	}
+
+	while (str < end && isspace((unsigned char) *str))
+		str++;
+	if (str < end && *str == '-') {
+		negative = true;
+		str++;
+	}
+	if (str == end || digit_value(*str, base) == base)
+		return false;
+	while (str < end && (*str == '0' || isspace((unsigned char) *str)))
+		str++;
+
+	if ((size_t) (end - str) > sizeof(stack_digits)) {
+		digits = (unsigned char *) malloc(length);
+		if (!digits) {
+			fprintf(stderr, "Out of memory.\n");
+			return false;
+		}
+	}
+	for (; str < end; str++) {
+		if (isspace((unsigned char) *str))
+			continue;
+		if ((value = digit_value(*str, base)) == base) {
+			if (digits != stack_digits)
+				free(digits);
+			return false;
+		}
+		digits[count++] = value;
+	}
+
+	if (count == 0) {
+		mpz_set_ui(n, 0);
+	} else {
+		// mpn_set_str() wants room for count digits of at most bits bits, plus a limb
+		for (bits = 1; (1 << bits) < base; bits++)
+			;
+		size = (count * bits + GMP_NUMB_BITS - 1) / GMP_NUMB_BITS + 1;
+		size = mpn_set_str(mpz_limbs_write(n, size), digits, count, base);
+		mpz_limbs_finish(n, negative ? -size : size);
+	}
+	if (digits != stack_digits)
+		free(digits);
+	return mpz_sgn(n) >= 0;
+}
+
+/**
+ * Open a batch input.
+ *
+ * @param input: The reader to initialize.
+ * @param path: The file to read, or "-" for standard input.
+ * @param format: The format of the records in the file.
+ * @return true on success
+ */
+bool open_input(input_t *input, const char *path, InputFormat format) {
+	input->format = format;
+	input->line = NULL;
+	input->line_size = 0;
+	input->line_number = 0;
+
+	if (strcmp(path, "-") == 0) {
+		input->file = stdin;
+	} else {
+		input->file = fopen(path, format == INPUT_RAW ? "rb" : "r");
+		if (!input->file) {
+			perror(path);
+			return false;
+		}
+	}
+	return true;
+}
+
+static int read_text(input_t *input, mpz_t n) {
+	ssize_t length;
+	char *start;
+
+	while ((length = getline(&input->line, &input->line_size, input->file)) >= 0) {
+		input->line_number++;
+
+		// Skip blank lines and comments
+		start = input->line;
+		while (isspace((unsigned char) *start))
+			start++;
+		if (*start == '\0' || *start == '#')
+			continue;
+
+		if (!parse_composite(n, start)) {
+			fprintf(stderr, "Invalid composite on line %u.\n", input->line_number);
+			return -1;
+		}
+		return 1;
+	}
+	return 0;
+}
+
+static int read_raw(input_t *input, mpz_t n) {
+	int c = getc(input->file);
+
+	if (c == EOF)
+		return 0;
+	ungetc(c, input->file);
+
+	input->line_number++;
+	if (mpz_inp_raw(n, input->file) == 0) {
+		fprintf(stderr, "Truncated raw record %u.\n", input->line_number);
+		return -1;
+	}
+	if (mpz_sgn(n) < 0) {
+		fprintf(stderr, "Invalid composite in raw record %u.\n", input->line_number);
+		return -1;
+	}
+	return 1;
+}
+
+/**
+ * Read the next composite from a batch input.
+ *
+ * @param input: The reader.
+ * @param n: Where to store the composite.
+ * @return 1 if a composite was read, 0 at end of input, -1 on a bad record
+ */
+int read_composite(input_t *input, mpz_t n) {
+	if (input->format == INPUT_RAW)
+		return read_raw(input, n);
+	return read_text(input, n);
+}
+
+void close_input(input_t *input) {
+	if (input->file && input->file != stdin)
+		fclose(input->file);
+	input->file = NULL;
+	free(input->line);
+	input->line = NULL;
+	input->line_size = 0;
+}
+
+/**
+ * Map a text batch file into memory so it can be read in place.
+ *
+ * Only non-empty regular files can be mapped; anything else, including
+ * standard input, is left to open_input().
+ *
+ * @param input: The mapping to initialize.
+ * @param path: The file to map.
+ * @return true if the file was mapped
+ */
+bool map_input(mapped_input_t *input, const char *path) {
+	struct stat st;
+	void *data;
+	int fd;
+
+	input->data = NULL;
+	input->size = 0;
+	if (strcmp(path, "-") == 0 || (fd = open(path, O_RDONLY)) < 0)
+		return false;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+		close(fd);
+		return false;
+	}
+
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return false;
+
+	// Each shard is read front to back, so read ahead and drop pages behind
+	madvise(data, st.st_size, MADV_SEQUENTIAL);
+	input->data = (const char *) data;
+	input->size = st.st_size;
+	return true;
+}
+
+/**
+ * Set up a shard for the lines that start in a byte range of a mapped input.
+ *
+ * Ranges need not fall on line boundaries: a line belongs to the shard its
+ * first byte is in, so adjacent ranges split the file without overlap.
+ *
+ * @param input: The mapped input.
+ * @param shard: The shard to initialize.
+ * @param start: The first byte of the range.
+ * @param end: One past the last byte of the range.
+ */
+void init_shard(const mapped_input_t *input, shard_t *shard, size_t start, size_t end) {
+	const char *newline;
+
+	if (start > 0 && start < input->size && input->data[start - 1] != '\n') {
+		newline = (const char *) memchr(input->data + start, '\n', input->size - start);
+		start = newline ? (size_t) (newline - input->data) + 1 : input->size;
+	}
+	shard->offset = start;
+	shard->end = end < input->size ? end : input->size;
+	shard->line_number = 0;
+}
+
+/**
+ * Parse the next composite in a shard, straight from the mapping.
+ *
+ * Blank lines and comments are skipped as in a streamed text input. Errors are
+ * not reported here, since only the caller knows where the shard starts.
+ *
+ * @param input: The mapped input.
+ * @param shard: The shard; shard->line_number is the line just read.
+ * @param n: Where to store the composite.
+ * @return 1 if a composite was read, 0 at the end of the shard, -1 on a bad line
+ */
+int next_composite(const mapped_input_t *input, shard_t *shard, mpz_t n) {
+	const char *line, *newline, *end;
+
+	while (shard->offset < shard->end) {
+		line = input->data + shard->offset;
+		newline = (const char *) memchr(line, '\n', input->size - shard->offset);
+		end = newline ? newline : input->data + input->size;
+		shard->offset = (end - input->data) + (newline != NULL);
+		shard->line_number++;
+
+		// Skip blank lines and comments
+		while (line < end && isspace((unsigned char) *line))
+			line++;
+		if (line == end || *line == '#')
+			continue;
+
+		return parse_composite_token(n, line, end - line) ? 1 : -1;
+	}
+	return 0;
+}
+
+void unmap_input(mapped_input_t *input) {
+	if (input->data)
+		munmap((void *) input->data, input->size);
+	input->data = NULL;
+	input->size = 0;
+}
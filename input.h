@@ -0,0 +1,72 @@
+/******************************************************************************
+ * Composite input parsing and batch readers.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef INPUT_H
+#define INPUT_H 1
+
+#include <stdio.h>
+
+#include <gmp.h>
+
+#include "rhoTypes.h"
+
+/* Batch input formats. */
+typedef enum {
+	INPUT_TEXT = 0,		// One composite per line, in any base parse_composite() accepts
+	INPUT_RAW = 1		// A stream of mpz_out_raw() records
+} InputFormat;
+
+typedef struct {
+	FILE *file;
+	InputFormat format;
+	char *line;			// getline() buffer, grown as needed
+	size_t line_size;
+	uint32 line_number;
+} input_t;
+
+/* A text batch file mapped into memory, read in place by any number of threads. */
+typedef struct {
+	const char *data;
+	size_t size;
+} mapped_input_t;
+
+/* A byte range of a mapped input holding whole lines. */
+typedef struct {
+	size_t offset;			// Start of the next line to read
+	size_t end;			// Lines starting at or past here belong to the next shard
+	uint32 line_number;		// Lines read so far, counted from the shard's start
+} shard_t;
+
+extern int input_base;
+
+bool parse_composite(mpz_t n, const char *str);
+bool parse_composite_token(mpz_t n, const char *str, size_t length);
+
+bool open_input(input_t *input, const char *path, InputFormat format);
+int read_composite(input_t *input, mpz_t n);
+void close_input(input_t *input);
+
+bool map_input(mapped_input_t *input, const char *path);
+void init_shard(const mapped_input_t *input, shard_t *shard, size_t start, size_t end);
+int next_composite(const mapped_input_t *input, shard_t *shard, mpz_t n);
+void unmap_input(mapped_input_t *input);
+
+#endif // INPUT_H
@@ -0,0 +1,412 @@
+/******************************************************************************
+ * Arithmetic kernels for the rho iteration.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#include <stdlib.h>
+
+#include <gmp.h>
+
+#include "kernel.h"
+
+#define ALWAYS_INLINE static inline __attribute__((always_inline))
+
+/*
+ * The helpers below take the limb count as a parameter, but are only ever
+ * inlined into the KERNEL(N) instances with a constant N, so every loop has
+ * a fixed trip count and the compiler can unroll it completely.
+ */
+
+ALWAYS_INLINE void load(mp_limb_t *r, mpz_t x, const mp_size_t N) {
+	const mp_limb_t *p = mpz_limbs_read(x);
+	mp_size_t size = mpz_size(x), i;
+
+#pragma GCC unroll 8
+	for (i = 0; i < N; i++)
+		r[i] = i < size ? p[i] : 0;
+}
+
+/* Montgomery reduction of t[0..2N) into r[0..N), r < n. Clobbers t. */
+ALWAYS_INLINE void redc(mp_limb_t *r, mp_limb_t *t, const mp_limb_t *n, mp_limb_t ninv, const mp_size_t N) {
+	mp_size_t i;
+	mp_limb_t cy;
+
+	// Each pass zeroes t[i]; its carry is parked there and added in at the end
+#pragma GCC unroll 8
+	for (i = 0; i < N; i++)
+		t[i] = mpn_addmul_1(t + i, n, N, t[i] * ninv);
+
+	cy = mpn_add_n(r, t + N, t, N);
+	if (cy || mpn_cmp(r, n, N) >= 0)
+		mpn_sub_n(r, r, n, N);
+}
+
+/* x^2 + c in Montgomery form. */
+ALWAYS_INLINE void montgomery_sqr(mpz_t output, mpz_t input, const rho_kernel_t *kernel, const mp_size_t N) {
+	mp_limb_t a[KERNEL_MAX_LIMBS], t[2 * KERNEL_MAX_LIMBS];
+	mp_limb_t *r, cy;
+
+	load(a, input, N);
+	mpn_sqr(t, a, N);
+
+	r = mpz_limbs_write(output, N);
+	redc(r, t, kernel->n, kernel->ninv, N);
+	cy = mpn_add_n(r, r, kernel->c, N);
+	if (cy || mpn_cmp(r, kernel->n, N) >= 0)
+		mpn_sub_n(r, r, kernel->n, N);
+	mpz_limbs_finish(output, N);
+}
+
+/* x^e + c for e > 2, by left-to-right binary exponentiation in Montgomery form. */
+ALWAYS_INLINE void montgomery_pow(mpz_t output, mpz_t input, const rho_kernel_t *kernel, const mp_size_t N) {
+	mp_limb_t a[KERNEL_MAX_LIMBS], x[KERNEL_MAX_LIMBS], t[2 * KERNEL_MAX_LIMBS];
+	mp_limb_t *r, cy;
+	int bit = 31 - __builtin_clz(kernel->exponent);
+
+	load(a, input, N);
+	mpn_copyi(x, a, N);
+	while (bit-- > 0) {
+		mpn_sqr(t, x, N);
+		redc(x, t, kernel->n, kernel->ninv, N);
+		if (kernel->exponent & (1U << bit)) {
+			mpn_mul_n(t, x, a, N);
+			redc(x, t, kernel->n, kernel->ninv, N);
+		}
+	}
+
+	r = mpz_limbs_write(output, N);
+	cy = mpn_add_n(r, x, kernel->c, N);
+	if (cy || mpn_cmp(r, kernel->n, N) >= 0)
+		mpn_sub_n(r, r, kernel->n, N);
+	mpz_limbs_finish(output, N);
+}
+
+ALWAYS_INLINE void montgomery_mul(mpz_t output, mpz_t a, mpz_t b, const rho_kernel_t *kernel, const mp_size_t N) {
+	mp_limb_t x[KERNEL_MAX_LIMBS], y[KERNEL_MAX_LIMBS], t[2 * KERNEL_MAX_LIMBS];
+
+	load(x, a, N);
+	load(y, b, N);
+	mpn_mul_n(t, x, y, N);
+
+	redc(mpz_limbs_write(output, N), t, kernel->n, kernel->ninv, N);
+	mpz_limbs_finish(output, N);
+}
+
+ALWAYS_INLINE void fixed_diff(mpz_t output, mpz_t x, mpz_t y, const mp_size_t N) {
+	mp_limb_t a[KERNEL_MAX_LIMBS], b[KERNEL_MAX_LIMBS];
+	mp_limb_t *r;
+
+	load(a, x, N);
+	load(b, y, N);
+
+	r = mpz_limbs_write(output, N);
+	if (mpn_cmp(a, b, N) >= 0)
+		mpn_sub_n(r, a, b, N);
+	else
+		mpn_sub_n(r, b, a, N);
+	mpz_limbs_finish(output, N);
+}
+
+#define KERNEL(N) \
+	MULTIVERSION static void sqr_##N(mpz_t output, mpz_t input, const rho_kernel_t *kernel) { \
+		montgomery_sqr(output, input, kernel, N); \
+	} \
+	MULTIVERSION static void pow_##N(mpz_t output, mpz_t input, const rho_kernel_t *kernel) { \
+		montgomery_pow(output, input, kernel, N); \
+	} \
+	MULTIVERSION static void mul_##N(mpz_t output, mpz_t a, mpz_t b, const rho_kernel_t *kernel) { \
+		montgomery_mul(output, a, b, kernel, N); \
+	} \
+	MULTIVERSION static void diff_##N(mpz_t output, mpz_t a, mpz_t b) { \
+		fixed_diff(output, a, b, N); \
+	}
+
+#if HAVE_INT128 && GMP_NUMB_BITS == 64
+/*
+ * One-limb moduli are common enough, and one limb short enough, that the calls
+ * into mpn dominate the step; configure selects these when the compiler has a
+ * 128-bit type, which becomes a single mulx where the target has BMI2.
+ */
+typedef unsigned __int128 uint128;
+
+ALWAYS_INLINE mp_limb_t load_1(mpz_t x) {
+	return mpz_size(x) ? mpz_limbs_read(x)[0] : 0;
+}
+
+ALWAYS_INLINE void store_1(mpz_t output, mp_limb_t value) {
+	mpz_limbs_write(output, 1)[0] = value;
+	mpz_limbs_finish(output, 1);
+}
+
+/* t / R mod n, for t < n * R; the low halves of t and m * n cancel. */
+ALWAYS_INLINE mp_limb_t redc_1(uint128 t, mp_limb_t n, mp_limb_t ninv) {
+	uint128 u = (uint128) ((mp_limb_t) t * ninv) * n;
+	mp_limb_t r;
+	int cy = __builtin_add_overflow((mp_limb_t) (t >> 64), (mp_limb_t) (u >> 64), &r);
+
+	cy |= __builtin_add_overflow(r, (mp_limb_t) t != 0, &r);
+	return cy || r >= n ? r - n : r;
+}
+
+ALWAYS_INLINE mp_limb_t add_c_1(mp_limb_t x, const rho_kernel_t *kernel) {
+	mp_limb_t r;
+	int cy = __builtin_add_overflow(x, kernel->c[0], &r);
+
+	return cy || r >= kernel->n[0] ? r - kernel->n[0] : r;
+}
+
+MULTIVERSION static void sqr_1(mpz_t output, mpz_t input, const rho_kernel_t *kernel) {
+	mp_limb_t x = load_1(input);
+
+	store_1(output, add_c_1(redc_1((uint128) x * x, kernel->n[0], kernel->ninv), kernel));
+}
+
+MULTIVERSION static void pow_1(mpz_t output, mpz_t input, const rho_kernel_t *kernel) {
+	mp_limb_t a = load_1(input), x = a;
+	int bit = 31 - __builtin_clz(kernel->exponent);
+
+	while (bit-- > 0) {
+		x = redc_1((uint128) x * x, kernel->n[0], kernel->ninv);
+		if (kernel->exponent & (1U << bit))
+			x = redc_1((uint128) x * a, kernel->n[0], kernel->ninv);
+	}
+	store_1(output, add_c_1(x, kernel));
+}
+
+MULTIVERSION static void mul_1(mpz_t output, mpz_t a, mpz_t b, const rho_kernel_t *kernel) {
+	store_1(output, redc_1((uint128) load_1(a) * load_1(b), kernel->n[0], kernel->ninv));
+}
+
+MULTIVERSION static void diff_1(mpz_t output, mpz_t a, mpz_t b) {
+	mp_limb_t x = load_1(a), y = load_1(b);
+
+	store_1(output, x >= y ? x - y : y - x);
+}
+#else
+KERNEL(1)
+#endif
+KERNEL(2)
+KERNEL(3)
+KERNEL(4)
+KERNEL(5)
+KERNEL(6)
+KERNEL(7)
+KERNEL(8)
+
+static const kernel_map_t sqr_kernels[KERNEL_MAX_LIMBS + 1] =
+	{ NULL, sqr_1, sqr_2, sqr_3, sqr_4, sqr_5, sqr_6, sqr_7, sqr_8 };
+static const kernel_map_t pow_kernels[KERNEL_MAX_LIMBS + 1] =
+	{ NULL, pow_1, pow_2, pow_3, pow_4, pow_5, pow_6, pow_7, pow_8 };
+static const kernel_mul_t mul_kernels[KERNEL_MAX_LIMBS + 1] =
+	{ NULL, mul_1, mul_2, mul_3, mul_4, mul_5, mul_6, mul_7, mul_8 };
+static const kernel_diff_t diff_kernels[KERNEL_MAX_LIMBS + 1] =
+	{ NULL, diff_1, diff_2, diff_3, diff_4, diff_5, diff_6, diff_7, diff_8 };
+
+/*
+ * x mod N = 2^k +- 1 by folding: 2^k is -+1 mod N, so the bits from k up are
+ * subtracted from or added to the low k bits until the value fits.
+ */
+static void special_reduce(const rho_kernel_t *kernel, mpz_t x) {
+	mpz_ptr high = &kernel->scratch[0];
+
+	while (mpz_sizeinbase(x, 2) > kernel->special_bits) {
+		mpz_tdiv_q_2exp(high, x, kernel->special_bits);
+		mpz_tdiv_r_2exp(x, x, kernel->special_bits);
+		if (kernel->special_sign < 0)
+			mpz_add(x, x, high);
+		else
+			mpz_sub(x, x, high);
+	}
+	if (mpz_sgn(x) < 0)
+		mpz_add(x, x, kernel->special);
+	else if (mpz_cmp(x, kernel->special) >= 0)
+		mpz_sub(x, x, kernel->special);
+}
+
+static void special_map(mpz_t output, mpz_t input, const rho_kernel_t *kernel) {
+	mpz_ptr base = &kernel->scratch[1];
+	int bit = 31 - __builtin_clz(kernel->exponent);
+
+	if (kernel->exponent & (kernel->exponent - 1))
+		mpz_set(base, input);
+	mpz_set(output, input);
+	while (bit-- > 0) {
+		mpz_mul(output, output, output);
+		special_reduce(kernel, output);
+		if (kernel->exponent & (1U << bit)) {
+			mpz_mul(output, output, base);
+			special_reduce(kernel, output);
+		}
+	}
+	mpz_add(output, output, kernel->constant);
+	special_reduce(kernel, output);
+}
+
+static void special_mul(mpz_t output, mpz_t a, mpz_t b, const rho_kernel_t *kernel) {
+	mpz_mul(output, a, b);
+	special_reduce(kernel, output);
+}
+
+/*
+ * Look for N = 2^k +- 1 with n | N and N no more than SPECIAL_MAX_GROWTH/2
+ * times the size of n, by stepping 2^k mod n until it is 1 or -1.
+ */
+static void find_special(rho_kernel_t *kernel, mpz_t n) {
+	mp_bitcnt_t bits = mpz_sizeinbase(n, 2), k;
+	mpz_t power, minus_one;
+
+	mpz_init(power);
+	mpz_init(minus_one);
+	mpz_sub_ui(minus_one, n, 1);
+	mpz_set_ui(power, 2);
+	mpz_powm_ui(power, power, bits - 1, n);
+
+	for (k = bits - 1; k <= bits * SPECIAL_MAX_GROWTH / 2; k++) {
+		if (mpz_cmp_ui(power, 1) == 0 || mpz_cmp(power, minus_one) == 0) {
+			kernel->special_bits = k;
+			kernel->special_sign = mpz_cmp_ui(power, 1) == 0 ? -1 : 1;
+			break;
+		}
+		mpz_mul_2exp(power, power, 1);
+		if (mpz_cmp(power, n) >= 0)
+			mpz_sub(power, power, n);
+	}
+	mpz_clear(power);
+	mpz_clear(minus_one);
+
+	if (!kernel->special_bits)
+		return;
+	mpz_init_set_ui(kernel->special, 0);
+	mpz_setbit(kernel->special, kernel->special_bits);
+	if (kernel->special_sign < 0)
+		mpz_sub_ui(kernel->special, kernel->special, 1);
+	else
+		mpz_add_ui(kernel->special, kernel->special, 1);
+	mpz_init_set(kernel->special_n, n);
+	kernel->scratch = (mpz_ptr) malloc(2 * sizeof(__mpz_struct));
+	mpz_init(&kernel->scratch[0]);
+	mpz_init(&kernel->scratch[1]);
+	kernel->map = special_map;
+	kernel->mul = special_mul;
+}
+
+/* -1/n0 mod 2^GMP_NUMB_BITS by Newton iteration; n0 must be odd. */
+static mp_limb_t negative_inverse(mp_limb_t n0) {
+	mp_limb_t inv = n0;		// Correct to 3 bits, since n0*n0 == 1 mod 8
+	int bits;
+
+	for (bits = 3; bits < GMP_NUMB_BITS; bits *= 2)
+		inv *= 2 - n0 * inv;
+	return -inv;
+}
+
+/**
+ * Select the kernel for a modulus and iteration map.
+ *
+ * @param kernel: The kernel to initialize.
+ * @param n: The number being factored.
+ * @param constant: The constant c in x^e + c.
+ * @param exponent: The exponent e in x^e + c, at least 2.
+ */
+void init_kernel(rho_kernel_t *kernel, mpz_t n, uint32 constant, uint32 exponent) {
+	mpz_t c;
+	mp_size_t i;
+
+	mpz_init_set_ui(kernel->constant, constant);
+	kernel->exponent = exponent;
+	kernel->limbs = 0;
+	kernel->map = NULL;
+	kernel->mul = NULL;
+	kernel->diff = NULL;
+	kernel->special_bits = 0;
+
+	if (mpz_odd_p(n) && mpz_size(n) > KERNEL_MAX_LIMBS) {
+		find_special(kernel, n);
+		return;
+	}
+	if (GMP_NAIL_BITS != 0 || mpz_even_p(n) || mpz_cmp_ui(n, 1) <= 0)
+		return;
+
+	kernel->limbs = mpz_size(n);
+	for (i = 0; i < kernel->limbs; i++)
+		kernel->n[i] = mpz_getlimbn(n, i);
+	kernel->ninv = negative_inverse(kernel->n[0]);
+
+	mpz_init_set_ui(c, constant);
+	kernel_enter(kernel, c, n);
+	for (i = 0; i < kernel->limbs; i++)
+		kernel->c[i] = mpz_getlimbn(c, i);
+	mpz_clear(c);
+
+	kernel->map = exponent == 2 ? sqr_kernels[kernel->limbs] : pow_kernels[kernel->limbs];
+	kernel->mul = mul_kernels[kernel->limbs];
+	kernel->diff = diff_kernels[kernel->limbs];
+}
+
+void clear_kernel(rho_kernel_t *kernel) {
+	mpz_clear(kernel->constant);
+	if (kernel->special_bits) {
+		mpz_clear(kernel->special);
+		mpz_clear(kernel->special_n);
+		mpz_clear(&kernel->scratch[0]);
+		mpz_clear(&kernel->scratch[1]);
+		free(kernel->scratch);
+		kernel->special_bits = 0;
+	}
+	kernel->map = NULL;
+	kernel->mul = NULL;
+	kernel->diff = NULL;
+}
+
+/**
+ * Convert a plain value into the kernel's representation.
+ *
+ * @param kernel: The kernel.
+ * @param x: The value to convert in place.
+ * @param n: The number being factored.
+ */
+void kernel_enter(const rho_kernel_t *kernel, mpz_t x, mpz_t n) {
+	if (kernel->limbs)
+		mpz_mul_2exp(x, x, kernel->limbs * GMP_NUMB_BITS);
+	mpz_mod(x, x, n);
+}
+
+/**
+ * Convert a value in the kernel's representation back to plain form.
+ *
+ * @param kernel: The kernel.
+ * @param x: The value to convert in place.
+ */
+void kernel_leave(const rho_kernel_t *kernel, mpz_t x) {
+	mp_limb_t t[2 * KERNEL_MAX_LIMBS], *r;
+	mp_size_t i, size = mpz_size(x);
+
+	if (kernel->special_bits) {
+		mpz_mod(x, x, kernel->special_n);
+		return;
+	}
+	if (!kernel->limbs)
+		return;
+
+	for (i = 0; i < 2 * kernel->limbs; i++)
+		t[i] = i < size ? mpz_getlimbn(x, i) : 0;
+	r = mpz_limbs_write(x, kernel->limbs);
+	redc(r, t, kernel->n, kernel->ninv, kernel->limbs);
+	mpz_limbs_finish(x, kernel->limbs);
+}
@@ -0,0 +1,94 @@
+/******************************************************************************
+ * Arithmetic kernels for the rho iteration.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef KERNEL_H
+#define KERNEL_H 1
+
+#include <gmp.h>
+
+#include "types.h"
+
+/*
+ * Odd moduli of up to KERNEL_MAX_LIMBS limbs are iterated in Montgomery form
+ * by kernels specialized for their exact limb count, so the hot loop never
+ * goes through mpz size checks or reallocation. Everything else falls back to
+ * the generic mpz path. Walk values are kept in the kernel's representation;
+ * differences of them have the same GCD with n as the plain values.
+ *
+ * The iteration map is x^e + c. The usual e = 2 is one squaring; a larger e
+ * costs a Montgomery exponentiation per step, but when every prime p sought
+ * has gcd(p - 1, e) = d, the walk mod p has only about (p - 1)/d + 1 values and
+ * its cycle is about sqrt(d - 1) times shorter. Factors of Cunningham numbers
+ * b^m +- 1 are 1 mod m (or 2m), so e = 2m pays off there.
+ */
+#define KERNEL_MAX_LIMBS 8
+
+/*
+ * A larger n that divides N = 2^k - 1 or 2^k + 1 is iterated mod N instead,
+ * where reducing a product is folding its high half onto the low half, and
+ * differences still have the right GCD with n because n divides N. N may have
+ * up to SPECIAL_MAX_GROWTH/2 times as many bits as n before a plain mpz
+ * reduction mod n is cheaper again.
+ */
+#define SPECIAL_MAX_GROWTH 3
+
+/*
+ * On x86-64 Linux, GCC clones each kernel for the x86-64 micro-architecture
+ * levels and picks the best one for the running CPU at load time, so one
+ * binary serves mixed hardware. Define NO_MULTIVERSION to build one version.
+ */
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__) && !defined(__clang__) \
+	&& __GNUC__ >= 11 && !defined(NO_MULTIVERSION)
+#define MULTIVERSION __attribute__((target_clones("default", "arch=x86-64-v2", "arch=x86-64-v3", "arch=x86-64-v4")))
+#else
+#define MULTIVERSION
+#endif
+
+typedef struct rho_kernel rho_kernel_t;
+
+typedef void (*kernel_map_t)(mpz_t output, mpz_t input, const rho_kernel_t *kernel);
+typedef void (*kernel_mul_t)(mpz_t output, mpz_t a, mpz_t b, const rho_kernel_t *kernel);
+typedef void (*kernel_diff_t)(mpz_t output, mpz_t a, mpz_t b);
+
+struct rho_kernel {
+	mp_size_t limbs;			// Limb count of n, or 0 for the generic path
+	mp_limb_t n[KERNEL_MAX_LIMBS];
+	mp_limb_t c[KERNEL_MAX_LIMBS];		// Polynomial constant, Montgomery form
+	mp_limb_t ninv;				// -1/n mod 2^GMP_NUMB_BITS
+	mpz_t constant;				// Polynomial constant, plain form
+	uint32 exponent;			// e in x^e + c
+	kernel_map_t map;			// x^e + c (NULL for the generic path)
+	kernel_mul_t mul;			// a * b / R, or a * b mod N (NULL for the generic path)
+	kernel_diff_t diff;			// |a - b| (NULL for the generic path)
+	mp_bitcnt_t special_bits;		// k if walking mod N = 2^k +- 1, else 0
+	int special_sign;			// N = 2^k + special_sign
+	mpz_t special;				// N
+	mpz_t special_n;			// n, to take values back out of N
+	mpz_ptr scratch;			// Two temporaries for the special-form map
+};
+
+void init_kernel(rho_kernel_t *kernel, mpz_t n, uint32 constant, uint32 exponent);
+void clear_kernel(rho_kernel_t *kernel);
+
+void kernel_enter(const rho_kernel_t *kernel, mpz_t x, mpz_t n);
+void kernel_leave(const rho_kernel_t *kernel, mpz_t x);
+
+#endif // KERNEL_H
@@ -0,0 +1,86 @@
+/******************************************************************************
+ * Repeated runs for timing, with --loop.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <gmp.h>
+
+#include "loop.h"
+
+uint64 loop_iterations = 0;
+
+static uint64 allocations = 0;
+static uint64 reallocations = 0;
+
+/*
+ * GMP's defaults are plain malloc, realloc and free, so memory allocated
+ * before counting starts is still freed correctly by these.
+ */
+static void *counting_alloc(size_t size) {
+	__atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+	return malloc(size);
+}
+
+static void *counting_realloc(void *old, size_t old_size, size_t new_size) {
+	(void) old_size;
+	__atomic_fetch_add(&reallocations, 1, __ATOMIC_RELAXED);
+	return realloc(old, new_size);
+}
+
+static void counting_free(void *block, size_t size) {
+	(void) size;
+	free(block);
+}
+
+/**
+ * Count GMP's allocations from now on.
+ */
+void count_allocations(void) {
+	mp_set_memory_functions(counting_alloc, counting_realloc, counting_free);
+}
+
+static int compare_seconds(const void *a, const void *b) {
+	double x = *(const double *) a, y = *(const double *) b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * Write the summary of a loop of runs to stderr.
+ *
+ * @param seconds: Wall time of each run; sorted in place.
+ * @param runs: The number of runs, at least 1.
+ */
+void loop_report(double *seconds, int runs) {
+	double total = 0, median;
+	int i;
+
+	qsort(seconds, runs, sizeof(double), compare_seconds);
+	for (i = 0; i < runs; i++)
+		total += seconds[i];
+	median = runs % 2 ? seconds[runs / 2] : (seconds[runs / 2 - 1] + seconds[runs / 2]) / 2;
+
+	fprintf(stderr, "loop runs=%d min=%.6f median=%.6f p99=%.6f iterations=%" PRIu64
+			" iterations_per_second=%.0f allocations=%" PRIu64 " reallocations=%" PRIu64 "\n",
+			runs, seconds[0], median, seconds[(99 * runs + 99) / 100 - 1], loop_iterations / runs,
+			total > 0 ? loop_iterations / total : 0.0, allocations / runs, reallocations / runs);
+}
@@ -0,0 +1,47 @@
+/******************************************************************************
+ * Repeated runs for timing, with --loop.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef LOOP_H
+#define LOOP_H 1
+
+#include "types.h"
+
+/*
+ * With --loop N the whole run is repeated N times, each from fresh state and
+ * only the first writing its factors, then one summary line goes to stderr:
+ *
+ *   loop runs=N min=S median=S p99=S iterations=I iterations_per_second=R
+ *        allocations=A reallocations=B
+ *
+ * Times are wall seconds per run, p99 by nearest rank. Iterations are walk
+ * iterations per run, and allocations those GMP makes per run, counted from
+ * count_allocations() on.
+ */
+extern uint64 loop_iterations;		// Iterations walked in all runs so far
+
+static inline void count_iterations(uint64 iterations) {
+	__atomic_fetch_add(&loop_iterations, iterations, __ATOMIC_RELAXED);
+}
+
+void count_allocations(void);
+void loop_report(double *seconds, int runs);
+
+#endif // LOOP_H
@@ -0,0 +1,220 @@
+/******************************************************************************
+ * Hardware performance counters around the rho walk.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+#include <gmp.h>
+
+#include "perf.h"
+#include "rho.h"
+
+typedef struct {
+	uint32 type;
+	uint64 config;
+	const char *name;
+} counter_t;
+
+static const counter_t counters[] = {
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,    "cycles"        },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,  "instructions"  },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES,  "cache_misses"  },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, "branch_misses" },
+	{ PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK,    "task_clock_ns" } };
+
+#define COUNTERS (sizeof(counters) / sizeof(counters[0]))
+
+static const char * const phase_names[] = { "walk", "gcd", "replay" };
+
+bool perf_enabled = false;
+
+static bool warned = false;
+
+/*
+ * Per-thread state. The group descriptors stay open until the thread calls
+ * end_perf_thread(); worker threads are started again for every batch, so
+ * they must close theirs before they exit.
+ */
+static __thread int group = -2;			// Group leader, -1 if unavailable, -2 before first use
+static __thread int opened[COUNTERS];		// Counters in the group, in read order
+static __thread int fds[COUNTERS];		// Their descriptors, in the same order
+static __thread int open_count;
+static __thread uint64 start_values[PERF_PHASES][COUNTERS];
+static __thread uint64 totals[PERF_PHASES][COUNTERS];
+
+/**
+ * Turn on counting for every walk from now on.
+ */
+void enable_perf(void) {
+	perf_enabled = true;
+}
+
+/*
+ * Open as many counters as this thread can get as one group, so they are
+ * scheduled together and read with a single call.
+ */
+static void open_counters(void) {
+	struct perf_event_attr attr;
+	int error = 0, fd;
+	size_t i;
+
+	group = -1;
+	open_count = 0;
+	for (i = 0; i < COUNTERS; i++) {
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = counters[i].type;
+		attr.config = counters[i].config;
+		attr.read_format = PERF_FORMAT_GROUP;
+		attr.disabled = group == -1;		// Members follow the leader
+		attr.exclude_kernel = 1;		// Also what perf_event_paranoid = 2 allows
+		attr.exclude_hv = 1;
+
+		fd = syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+		if (fd < 0) {
+			error = errno;
+			continue;
+		}
+		if (group == -1)
+			group = fd;
+		fds[open_count] = fd;
+		opened[open_count++] = i;
+	}
+
+	if (group == -1) {
+		if (!__atomic_exchange_n(&warned, true, __ATOMIC_RELAXED))
+			fprintf(stderr, "Performance counters unavailable (%s); continuing without them.\n",
+					strerror(error));
+		return;
+	}
+	ioctl(group, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+/**
+ * Close this thread's counters, before the thread exits. The next walk on the
+ * thread, if any, opens them again.
+ */
+void end_perf_thread(void) {
+	int i;
+
+	if (group >= 0) {
+		for (i = open_count - 1; i >= 0; i--)		// Members before their leader
+			close(fds[i]);
+	}
+	group = -2;
+	open_count = 0;
+}
+
+static void read_counters(uint64 *values) {
+	uint64 buffer[1 + COUNTERS];
+	int i;
+
+	if (read(group, buffer, sizeof(buffer)) < (ssize_t) ((1 + open_count) * sizeof(uint64)))
+		memset(buffer, 0, sizeof(buffer));
+	for (i = 0; i < open_count; i++)
+		values[opened[i]] = buffer[1 + i];
+}
+
+/**
+ * Snapshot this thread's counters at the start of a phase. Starting a walk
+ * zeroes the totals of the last one.
+ *
+ * @param phase: The phase being entered.
+ */
+void perf_start(PerfPhase phase) {
+	if (group == -2)
+		open_counters();
+	if (group < 0)
+		return;
+	if (phase == PERF_WALK)
+		memset(totals, 0, sizeof(totals));
+	read_counters(start_values[phase]);
+}
+
+/**
+ * Add what this thread counted since perf_start() to the phase's totals.
+ *
+ * @param phase: The phase being left.
+ */
+void perf_stop(PerfPhase phase) {
+	uint64 values[COUNTERS];
+	int i;
+
+	if (group < 0)
+		return;
+	read_counters(values);
+	for (i = 0; i < open_count; i++)
+		totals[phase][opened[i]] += values[opened[i]] - start_values[phase][opened[i]];
+}
+
+static void report_phase(const char *phase, const uint64 *values, mpz_t n, uint32 constant,
+		uint64 iterations) {
+	int i;
+
+	gmp_fprintf(stderr, "perf engine=%s n=%Zd polynomial=%u phase=%s iterations=%" PRIu64,
+			engine_name, n, constant, phase, iterations);
+	for (i = 0; i < open_count; i++)
+		fprintf(stderr, " %s=%" PRIu64, counters[opened[i]].name, values[opened[i]]);
+	for (i = 0; i < open_count; i++) {
+		if (iterations > 0 && counters[opened[i]].type == PERF_TYPE_HARDWARE)
+			fprintf(stderr, " %s_per_iteration=%.2f", counters[opened[i]].name,
+					(double) values[opened[i]] / iterations);
+	}
+	fputc('\n', stderr);
+}
+
+/**
+ * Print this thread's totals for the walk just finished, one key=value line
+ * per phase on stderr. "step" is the walk less its GCDs and replays.
+ *
+ * @param n: The number the walk was on.
+ * @param constant: The polynomial constant.
+ * @param iterations: Iterations the walk took.
+ */
+void perf_report(mpz_t n, uint32 constant, uint64 iterations) {
+	uint64 step[COUNTERS];
+	int phase, i;
+
+	if (group < 0)
+		return;
+
+	for (i = 0; i < open_count; i++) {
+		step[opened[i]] = totals[PERF_WALK][opened[i]];
+		for (phase = PERF_GCD; phase < PERF_PHASES; phase++) {
+			uint64 part = totals[phase][opened[i]];
+
+			step[opened[i]] -= part < step[opened[i]] ? part : step[opened[i]];
+		}
+	}
+
+	flockfile(stderr);
+	report_phase(phase_names[PERF_WALK], totals[PERF_WALK], n, constant, iterations);
+	report_phase("step", step, n, constant, iterations);
+	for (phase = PERF_GCD; phase < PERF_PHASES; phase++)
+		report_phase(phase_names[phase], totals[phase], n, constant, iterations);
+	funlockfile(stderr);
+}
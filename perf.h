@@ -0,0 +1,62 @@
+/******************************************************************************
+ * Hardware performance counters around the rho walk.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef PERF_H
+#define PERF_H 1
+
+#include <gmp.h>
+
+#include "rhoTypes.h"
+
+/*
+ * Each thread counts its own user-space cycles, instructions, cache misses,
+ * branch mispredictions and task clock through perf_event_open. Counters the
+ * kernel or CPU cannot provide are left out; if none can be opened, --perf
+ * warns once and the run goes on unmeasured.
+ *
+ * PERF_WALK spans a whole run_rho; PERF_GCD and PERF_REPLAY accumulate the
+ * GCDs and the block replays inside it. The rest of the walk is stepping.
+ */
+typedef enum { PERF_WALK = 0, PERF_GCD = 1, PERF_REPLAY = 2, PERF_PHASES = 3 } PerfPhase;
+
+extern bool perf_enabled;		// Set by enable_perf(), read by the hooks
+
+void enable_perf(void);
+void perf_start(PerfPhase phase);
+void perf_stop(PerfPhase phase);
+void perf_report(mpz_t n, uint32 constant, uint64 iterations);
+void end_perf_thread(void);
+
+/*
+ * The hooks below are what the engines call. With counters off they cost one
+ * load and a well-predicted branch.
+ */
+static inline void perf_begin(PerfPhase phase) {
+	if (__builtin_expect(perf_enabled, 0))
+		perf_start(phase);
+}
+
+static inline void perf_end(PerfPhase phase) {
+	if (__builtin_expect(perf_enabled, 0))
+		perf_stop(phase);
+}
+
+#endif // PERF_H
@@ -0,0 +1,533 @@
+/******************************************************************************
+ * Pipelined batch mode: reader, rho workers and writer in separate threads.
+ *
+ * The reader (the calling thread) parses composites into a fixed pool of job
+ * slots, each with its own preallocated mpz. Each worker factors into a
+ * factorization object of its own, allocated after it is pinned, and formats
+ * the result into the job; the writer thread prints the results in input
+ * order through one large buffer. Slot numbers move between the stages through
+ * bounded lock-free queues, so base conversion on either end never holds up a
+ * walk.
+ *
+ * Large text files skip the reader: they are mapped into memory and split
+ * into byte ranges that the workers claim and parse in place.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <gmp.h>
+
+#include "affinity.h"
+#include "control.h"
+#include "perf.h"
+#include "pipeline.h"
+#include "queue.h"
+#include "rho.h"
+#include "trace.h"
+
+#define SLOTS_PER_WORKER 8		// Jobs in flight per worker, so no stage waits on another
+#define SLOTS_MIN 64
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+#define END_OF_INPUT 0xffffffffU	// Sent to each worker after the last job
+
+typedef struct {
+	mpz_t composite;
+	char *text;			// The result, formatted by the worker; NULL if there is none
+	size_t length;
+	uint64 sequence;		// Position in the input
+} job_t;
+
+typedef struct {
+	input_t *input;
+	pipeline_output_t output;
+	job_t *jobs;
+	uint32 slots;
+	int workers;
+	queue_t free_slots;		// Reader takes empty slots from here
+	queue_t work;			// Parsed jobs for the workers
+	queue_t finished;		// Factored jobs for the writer, in any order
+	uint64 total;			// Jobs read, valid once input_done is set
+	int pinned;			// Workers that have taken a CPU
+	bool input_done;
+	bool bad_input;
+} pipeline_t;
+
+// Our own stream on standard output, so the buffer can be large from the start
+static FILE *open_output(void) {
+	FILE *out = fdopen(dup(STDOUT_FILENO), "w");
+
+	if (!out) {
+		perror("stdout");
+		return stdout;
+	}
+	setvbuf(out, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+	return out;
+}
+
+static void close_output(FILE *out) {
+	if (out != stdout)
+		fclose(out);
+	else
+		fflush(out);
+}
+
+static void read_jobs(pipeline_t *pipeline) {
+	uint64 sequence = 0;
+	uint32 slot;
+	int status = 0, i;
+
+	for (;;) {
+		slot = queue_pop(&pipeline->free_slots);
+		while (!stop_requested && (status = read_composite(pipeline->input, pipeline->jobs[slot].composite)) < 0)
+			pipeline->bad_input = true;
+		if (stop_requested || status == 0) {
+			queue_push(&pipeline->free_slots, slot);
+			break;
+		}
+		pipeline->jobs[slot].sequence = sequence++;
+		queue_push(&pipeline->work, slot);
+	}
+
+	__atomic_store_n(&pipeline->total, sequence, __ATOMIC_RELAXED);
+	__atomic_store_n(&pipeline->input_done, true, __ATOMIC_RELEASE);
+	for (i = 0; i < pipeline->workers; i++)
+		queue_push(&pipeline->work, END_OF_INPUT);
+}
+
+static void factor_job(pipeline_t *pipeline, job_t *job, fact_obj_t *fobj) {
+	FILE *out;
+
+	fobj->rho_obj.iterations = max_iterations;
+	start_budget(fobj, time_limit, cpu_limit);
+	factor_composite(fobj, job->composite, NULL);
+
+	out = open_memstream(&job->text, &job->length);
+	if (!out) {
+		perror("open_memstream");
+		job->text = NULL;
+		job->length = 0;
+		return;
+	}
+	pipeline->output(out, job->composite, fobj);
+	fclose(out);
+}
+
+static void *factor_jobs(void *arg) {
+	pipeline_t *pipeline = (pipeline_t *) arg;
+	fact_obj_t fobj;
+	uint32 slot;
+	job_t *job;
+
+	pin_worker(__atomic_fetch_add(&pipeline->pinned, 1, __ATOMIC_RELAXED));
+	init_factobj(&fobj);
+	while ((slot = queue_pop(&pipeline->work)) != END_OF_INPUT) {
+		job = &pipeline->jobs[slot];
+		job->text = NULL;
+		job->length = 0;
+		if (!stop_requested)
+			factor_job(pipeline, job, &fobj);
+		queue_push(&pipeline->finished, slot);
+	}
+
+	free_factobj(&fobj);
+	end_trace_thread();
+	end_perf_thread();
+	return NULL;
+}
+
+/* Print jobs strictly in input order, holding back any that finish early. */
+static void *write_jobs(void *arg) {
+	pipeline_t *pipeline = (pipeline_t *) arg;
+	uint32 *waiting, slot;
+	uint64 next = 0;
+	job_t *job;
+	FILE *out;
+	int attempts = 0;
+
+	out = open_output();
+	// At most one job per slot is in flight, so sequence modulo slots cannot collide
+	waiting = (uint32 *) calloc(pipeline->slots, sizeof(uint32));
+
+	for (;;) {
+		while ((slot = waiting[next % pipeline->slots]) != 0) {
+			job = &pipeline->jobs[slot - 1];
+			waiting[next % pipeline->slots] = 0;
+			if (job->length)
+				fwrite(job->text, 1, job->length, out);
+			free(job->text);
+			job->text = NULL;
+			queue_push(&pipeline->free_slots, slot - 1);
+			next++;
+		}
+
+		if (__atomic_load_n(&pipeline->input_done, __ATOMIC_ACQUIRE)
+				&& next == __atomic_load_n(&pipeline->total, __ATOMIC_RELAXED))
+			break;
+
+		if (queue_try_pop(&pipeline->finished, &slot)) {
+			waiting[pipeline->jobs[slot].sequence % pipeline->slots] = slot + 1;
+			attempts = 0;
+		} else {
+			// Nothing ready: let the buffered output go rather than sit on it
+			if (attempts == 0)
+				fflush(out);
+			queue_wait(&attempts);
+		}
+	}
+
+	free(waiting);
+	close_output(out);
+	return NULL;
+}
+
+/**
+ * Factor every composite in a batch input with a reader, worker and writer pipeline.
+ *
+ * @param input: The open batch input.
+ * @param workers: How many rho worker threads to run.
+ * @param output: Prints each result into its job's buffer; called from the workers.
+ * @return 0 on success, 1 if the input held bad records or threads could not start
+ */
+int run_pipeline(input_t *input, int workers, pipeline_output_t output) {
+	pipeline_t pipeline;
+	pthread_t writer, *threads;
+	uint32 i;
+	int started, result = 0;
+
+	pipeline.input = input;
+	pipeline.output = output;
+	pipeline.slots = MAX(SLOTS_MIN, SLOTS_PER_WORKER * workers);
+	pipeline.total = 0;
+	pipeline.pinned = 0;
+	pipeline.input_done = false;
+	pipeline.bad_input = false;
+
+	if (!init_queue(&pipeline.free_slots, pipeline.slots)) {
+		fprintf(stderr, "Out of memory.\n");
+		return 1;
+	}
+	// The work queue also carries one end marker per worker
+	if (!init_queue(&pipeline.work, pipeline.slots + workers)) {
+		free_queue(&pipeline.free_slots);
+		fprintf(stderr, "Out of memory.\n");
+		return 1;
+	}
+	if (!init_queue(&pipeline.finished, pipeline.slots)) {
+		free_queue(&pipeline.free_slots);
+		free_queue(&pipeline.work);
+		fprintf(stderr, "Out of memory.\n");
+		return 1;
+	}
+	pipeline.jobs = (job_t *) malloc(pipeline.slots * sizeof(job_t));
+	threads = (pthread_t *) malloc(workers * sizeof(pthread_t));
+	if (!pipeline.jobs || !threads) {
+		free(pipeline.jobs);
+		free(threads);
+		free_queue(&pipeline.free_slots);
+		free_queue(&pipeline.work);
+		free_queue(&pipeline.finished);
+		fprintf(stderr, "Out of memory.\n");
+		return 1;
+	}
+	for (i = 0; i < pipeline.slots; i++) {
+		mpz_init(pipeline.jobs[i].composite);
+		queue_push(&pipeline.free_slots, i);
+	}
+
+	// Anything already printed must come out before the writer's stream
+	fflush(stdout);
+	started = 0;
+	if (pthread_create(&writer, NULL, write_jobs, &pipeline) == 0) {
+		for (started = 0; started < workers; started++) {
+			if (pthread_create(&threads[started], NULL, factor_jobs, &pipeline) != 0)
+				break;
+		}
+		pipeline.workers = started;
+
+		if (started > 0) {
+			read_jobs(&pipeline);
+			for (i = 0; i < (uint32) started; i++)
+				pthread_join(threads[i], NULL);
+		} else {
+			__atomic_store_n(&pipeline.input_done, true, __ATOMIC_RELEASE);
+		}
+		pthread_join(writer, NULL);
+	}
+	if (started == 0) {
+		fprintf(stderr, "Could not start the batch threads.\n");
+		result = 1;
+	}
+
+	for (i = 0; i < pipeline.slots; i++)
+		mpz_clear(pipeline.jobs[i].composite);
+	free(pipeline.jobs);
+	free(threads);
+	free_queue(&pipeline.free_slots);
+	free_queue(&pipeline.work);
+	free_queue(&pipeline.finished);
+
+	if (pipeline.bad_input)
+		result = 1;
+	return result;
+}
+
+/*---------------------------- MAPPED SHARDS ----------------------------*/
+
+#define SHARDS_PER_WORKER 16		// Shards per worker over the whole file, for load balance
+#define SHARD_MIN_SIZE (64 << 10)
+#define SHARD_MAX_SIZE (1 << 20)
+#define RESULTS_PER_WORKER 2		// Shards in flight per worker, each holding its formatted results
+
+typedef struct {
+	uint64 index;			// Which shard of the input
+	char *text;			// Its results, formatted by the output callback
+	size_t length;
+	uint32 lines;			// Lines read from the shard
+	bool complete;			// False if a stop request cut the shard short
+	uint32 *bad_lines;		// Bad lines, counted from the shard's start
+	uint32 bad_count;
+	uint32 bad_allocated;
+} shard_result_t;
+
+typedef struct {
+	const mapped_input_t *input;
+	pipeline_output_t output;
+	shard_result_t *results;
+	uint32 slots;
+	size_t shard_size;
+	uint64 shards;
+	uint64 next_shard;		// Claimed by workers with an atomic increment
+	queue_t free_slots;		// Workers take a result slot here before claiming a shard
+	queue_t finished;		// Completed shards for the writer, in any order
+	int pinned;			// Workers that have taken a CPU
+	bool workers_done;
+	bool bad_input;			// Set by the writer
+} shard_pipeline_t;
+
+static void add_bad_line(shard_result_t *result, uint32 line) {
+	if (result->bad_count == result->bad_allocated) {
+		result->bad_allocated = result->bad_allocated ? 2 * result->bad_allocated : 16;
+		result->bad_lines = (uint32 *) realloc(result->bad_lines, result->bad_allocated * sizeof(uint32));
+	}
+	result->bad_lines[result->bad_count++] = line;
+}
+
+static void factor_shard(shard_pipeline_t *pipeline, shard_result_t *result, fact_obj_t *fobj, mpz_t composite) {
+	shard_t shard;
+	FILE *out;
+	int status = 0;
+
+	init_shard(pipeline->input, &shard, result->index * pipeline->shard_size,
+		(result->index + 1) * pipeline->shard_size);
+	result->bad_count = 0;
+	out = open_memstream(&result->text, &result->length);
+	if (!out) {
+		// Leave the shard's results out; the lines still count so later ones are numbered right
+		perror("open_memstream");
+		result->text = NULL;
+		result->length = 0;
+	}
+
+	while (!stop_requested && (status = next_composite(pipeline->input, &shard, composite)) != 0) {
+		if (status < 0) {
+			add_bad_line(result, shard.line_number);
+			continue;
+		}
+		if (!out)
+			continue;
+		fobj->rho_obj.iterations = max_iterations;
+		start_budget(fobj, time_limit, cpu_limit);
+		factor_composite(fobj, composite, NULL);
+		pipeline->output(out, composite, fobj);
+	}
+	result->lines = shard.line_number;
+	result->complete = status == 0;
+	if (out)
+		fclose(out);
+}
+
+static void *factor_shards(void *arg) {
+	shard_pipeline_t *pipeline = (shard_pipeline_t *) arg;
+	fact_obj_t fobj;
+	mpz_t composite;
+	uint32 slot;
+
+	pin_worker(__atomic_fetch_add(&pipeline->pinned, 1, __ATOMIC_RELAXED));
+	init_factobj(&fobj);
+	mpz_init(composite);
+
+	/*
+	 * Take the result slot first: a shard is only claimed once there is room
+	 * for it, so claimed but unwritten shards never outnumber the slots.
+	 */
+	for (;;) {
+		slot = queue_pop(&pipeline->free_slots);
+		if (stop_requested)
+			break;
+		pipeline->results[slot].index = __atomic_fetch_add(&pipeline->next_shard, 1, __ATOMIC_RELAXED);
+		if (pipeline->results[slot].index >= pipeline->shards)
+			break;
+		factor_shard(pipeline, &pipeline->results[slot], &fobj, composite);
+		queue_push(&pipeline->finished, slot);
+	}
+	queue_push(&pipeline->free_slots, slot);
+
+	mpz_clear(composite);
+	free_factobj(&fobj);
+	end_trace_thread();
+	end_perf_thread();
+	return NULL;
+}
+
+/* Print shards strictly in input order, numbering bad lines across the whole file. */
+static void *write_shards(void *arg) {
+	shard_pipeline_t *pipeline = (shard_pipeline_t *) arg;
+	shard_result_t *result;
+	uint32 *waiting, slot, i;
+	uint64 next = 0, line_base = 0;
+	FILE *out = open_output();
+	int attempts = 0;
+	bool truncated = false;
+
+	waiting = (uint32 *) calloc(pipeline->slots, sizeof(uint32));
+
+	for (;;) {
+		while ((slot = waiting[next % pipeline->slots]) != 0) {
+			result = &pipeline->results[slot - 1];
+			waiting[next % pipeline->slots] = 0;
+			// After a shard cut short by a stop, later ones would leave a gap in the output
+			if (!truncated) {
+				if (result->bad_count)
+					pipeline->bad_input = true;
+				for (i = 0; i < result->bad_count; i++)
+					fprintf(stderr, "Invalid composite on line %" PRIu64 ".\n", line_base + result->bad_lines[i]);
+				if (result->length)
+					fwrite(result->text, 1, result->length, out);
+				truncated = !result->complete;
+			}
+			free(result->text);
+			result->text = NULL;
+			line_base += result->lines;
+			queue_push(&pipeline->free_slots, slot - 1);
+			next++;
+		}
+
+		// Every claimed shard below the count has been finished once the workers are gone
+		if (__atomic_load_n(&pipeline->workers_done, __ATOMIC_ACQUIRE)
+				&& next >= MIN(__atomic_load_n(&pipeline->next_shard, __ATOMIC_RELAXED), pipeline->shards))
+			break;
+
+		if (queue_try_pop(&pipeline->finished, &slot)) {
+			waiting[pipeline->results[slot].index % pipeline->slots] = slot + 1;
+			attempts = 0;
+		} else {
+			if (attempts == 0)
+				fflush(out);
+			queue_wait(&attempts);
+		}
+	}
+
+	free(waiting);
+	close_output(out);
+	return NULL;
+}
+
+/**
+ * Factor every composite in a mapped text input, with the file split into
+ * byte ranges that worker threads claim and parse in place.
+ *
+ * There is no reader thread: each worker tokenizes its own shard straight out
+ * of the mapping, so all of them start at once. Shards are claimed in file
+ * order and the writer prints them in that order.
+ *
+ * @param input: The mapped input.
+ * @param workers: How many rho worker threads to run.
+ * @param output: Prints each result into its shard's buffer; called from the workers.
+ * @return 0 on success, 1 if the input held bad lines or threads could not start
+ */
+int run_shards(const mapped_input_t *input, int workers, pipeline_output_t output) {
+	shard_pipeline_t pipeline;
+	pthread_t writer, *threads;
+	uint32 i;
+	int started = 0, result = 0;
+
+	pipeline.input = input;
+	pipeline.output = output;
+	pipeline.slots = RESULTS_PER_WORKER * workers;
+	pipeline.shard_size = input->size / ((size_t) SHARDS_PER_WORKER * workers);
+	pipeline.shard_size = MIN(MAX(pipeline.shard_size, SHARD_MIN_SIZE), SHARD_MAX_SIZE);
+	pipeline.shards = (input->size + pipeline.shard_size - 1) / pipeline.shard_size;
+	pipeline.next_shard = 0;
+	pipeline.pinned = 0;
+	pipeline.workers_done = false;
+	pipeline.bad_input = false;
+
+	if (!init_queue(&pipeline.free_slots, pipeline.slots)) {
+		fprintf(stderr, "Out of memory.\n");
+		return 1;
+	}
+	if (!init_queue(&pipeline.finished, pipeline.slots)) {
+		free_queue(&pipeline.free_slots);
+		fprintf(stderr, "Out of memory.\n");
+		return 1;
+	}
+	pipeline.results = (shard_result_t *) calloc(pipeline.slots, sizeof(shard_result_t));
+	threads = (pthread_t *) malloc(workers * sizeof(pthread_t));
+	if (!pipeline.results || !threads) {
+		free(pipeline.results);
+		free(threads);
+		free_queue(&pipeline.free_slots);
+		free_queue(&pipeline.finished);
+		fprintf(stderr, "Out of memory.\n");
+		return 1;
+	}
+	for (i = 0; i < pipeline.slots; i++)
+		queue_push(&pipeline.free_slots, i);
+
+	fflush(stdout);
+	if (pthread_create(&writer, NULL, write_shards, &pipeline) == 0) {
+		for (started = 0; started < workers; started++) {
+			if (pthread_create(&threads[started], NULL, factor_shards, &pipeline) != 0)
+				break;
+		}
+		for (i = 0; i < (uint32) started; i++)
+			pthread_join(threads[i], NULL);
+		__atomic_store_n(&pipeline.workers_done, true, __ATOMIC_RELEASE);
+		pthread_join(writer, NULL);
+	}
+	if (started == 0) {
+		fprintf(stderr, "Could not start the batch threads.\n");
+		result = 1;
+	}
+
+	for (i = 0; i < pipeline.slots; i++)
+		free(pipeline.results[i].bad_lines);
+	free(pipeline.results);
+	free(threads);
+	free_queue(&pipeline.free_slots);
+	free_queue(&pipeline.finished);
+
+	if (pipeline.bad_input)
+		result = 1;
+	return result;
+}
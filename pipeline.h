@@ -0,0 +1,41 @@
+/******************************************************************************
+ * Pipelined batch mode: reader, rho workers and writer in separate threads.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef PIPELINE_H
+#define PIPELINE_H 1
+
+#include <stdio.h>
+
+#include <gmp.h>
+
+#include "input.h"
+#include "rhoTypes.h"
+
+/* Prints one finished composite into a buffer of its own; called from the workers. */
+typedef void (*pipeline_output_t)(FILE *out, mpz_t composite, fact_obj_t *fobj);
+
+/* Text files at least this large are mapped and sharded rather than streamed. */
+#define SHARDED_MIN_SIZE (1 << 20)
+
+int run_pipeline(input_t *input, int workers, pipeline_output_t output);
+int run_shards(const mapped_input_t *input, int workers, pipeline_output_t output);
+
+#endif // PIPELINE_H
@@ -0,0 +1,120 @@
+/******************************************************************************
+ * Seeded pseudo-random walks.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#include <gmp.h>
+
+#include "prng.h"
+
+bool seeded = false;
+uint64 run_seed = 0;
+
+/* SplitMix64's output function, used to spread seeds over all 64 bits. */
+static uint64 splitmix64(uint64 *state) {
+	uint64 z = (*state += 0x9e3779b97f4a7c15ULL);
+
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+/**
+ * Combine a seed with a value into a new seed.
+ *
+ * @param seed: The seed.
+ * @param value: The value to fold in.
+ * @return a seed that differs for any change in either input
+ */
+uint64 mix_seed(uint64 seed, uint64 value) {
+	uint64 state = seed ^ splitmix64(&value);
+
+	return splitmix64(&state);
+}
+
+/**
+ * The seed of one walk of a seeded run.
+ *
+ * @param n: The number the walk factors.
+ * @param index: The polynomial index of the walk.
+ * @return the walk's seed, never 0
+ */
+uint64 walk_seed(mpz_t n, uint32 index) {
+	uint64 seed = mix_seed(run_seed, index);
+	size_t i;
+
+	for (i = 0; i < mpz_size(n); i++)
+		seed = mix_seed(seed, mpz_getlimbn(n, i));
+	return seed ? seed : 1;
+}
+
+/**
+ * Seed a generator, expanding the seed with SplitMix64 as xoshiro's authors advise.
+ *
+ * @param prng: The generator.
+ * @param seed: The seed.
+ */
+void seed_prng(prng_t *prng, uint64 seed) {
+	int i;
+
+	for (i = 0; i < 4; i++)
+		prng->s[i] = splitmix64(&seed);
+}
+
+/**
+ * Draw a value uniformly from [0, n), up to a bias of 2^-64.
+ *
+ * @param prng: The generator.
+ * @param output: Receives the value.
+ * @param n: The bound; must be positive.
+ */
+void prng_below(prng_t *prng, mpz_t output, mpz_t n) {
+	mp_size_t limbs = (mpz_sizeinbase(n, 2) + 64 + GMP_NUMB_BITS - 1) / GMP_NUMB_BITS, i;
+	mp_limb_t *p = mpz_limbs_write(output, limbs);
+
+	for (i = 0; i < limbs; i++)
+		p[i] = (mp_limb_t) prng_next(prng) & GMP_NUMB_MASK;
+	mpz_limbs_finish(output, limbs);
+	mpz_mod(output, output, n);
+}
+
+/**
+ * Draw a polynomial constant c for x^2 + c that is usable with n.
+ *
+ * c is never 0 or -2 mod n, since x^2 and x^2 - 2 make poor walks.
+ *
+ * @param prng: The generator.
+ * @param n: The number being factored; must be above 2.
+ * @return the constant
+ */
+uint32 prng_constant(prng_t *prng, mpz_t n) {
+	unsigned long c, small;
+
+	for (;;) {
+		c = (uint32) (prng_next(prng) >> 32);
+		if (c == 0)
+			continue;
+		if (mpz_cmp_ui(n, c + 2) > 0)
+			return c;
+		// Only an n this small can divide c or c + 2
+		small = mpz_get_ui(n);
+		if (c % small != 0 && (c + 2) % small != 0)
+			return c;
+	}
+}
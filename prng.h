@@ -0,0 +1,67 @@
+/******************************************************************************
+ * Seeded pseudo-random walks.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef PRNG_H
+#define PRNG_H 1
+
+#include <gmp.h>
+
+#include "rhoTypes.h"
+
+/*
+ * With --seed, every walk gets its own seed, derived from the run seed, the
+ * number being factored and the polynomial index, and draws its starting value
+ * and constant from xoshiro256** seeded with it. A walk depends on nothing
+ * else, so it is the same in any batch position, thread or daemon session, and
+ * a retry with another run seed walks somewhere new.
+ */
+typedef struct {
+	uint64 s[4];
+} prng_t;
+
+extern bool seeded;
+extern uint64 run_seed;
+
+uint64 mix_seed(uint64 seed, uint64 value);
+uint64 walk_seed(mpz_t n, uint32 index);
+void seed_prng(prng_t *prng, uint64 seed);
+void prng_below(prng_t *prng, mpz_t output, mpz_t n);
+uint32 prng_constant(prng_t *prng, mpz_t n);
+
+static inline uint64 rotl64(uint64 x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+/* The next output of xoshiro256**. */
+static inline uint64 prng_next(prng_t *prng) {
+	uint64 *s = prng->s;
+	uint64 result = rotl64(s[1] * 5, 7) * 9, t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl64(s[3], 45);
+	return result;
+}
+
+#endif // PRNG_H
@@ -0,0 +1,166 @@
+/******************************************************************************
+ * Bounded lock-free queues for handing work between threads.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "queue.h"
+
+#define SPIN_LIMIT 64			// Busy retries before yielding the CPU
+#define YIELD_LIMIT 128			// Retries before sleeping between attempts
+#define BACKOFF_NANOSECONDS 50000
+
+/**
+ * Allocate an empty queue.
+ *
+ * @param queue: The queue to initialize.
+ * @param capacity: The most values it holds; rounded up to a power of two.
+ * @return false if out of memory
+ */
+bool init_queue(queue_t *queue, uint32 capacity) {
+	uint64 size = 2, i;
+
+	while (size < capacity)
+		size *= 2;
+
+	queue->cells = (queue_cell_t *) malloc(size * sizeof(queue_cell_t));
+	if (!queue->cells)
+		return false;
+	for (i = 0; i < size; i++)
+		queue->cells[i].sequence = i;
+	queue->mask = size - 1;
+	queue->enqueue_position = 0;
+	queue->dequeue_position = 0;
+	return true;
+}
+
+void free_queue(queue_t *queue) {
+	free(queue->cells);
+	queue->cells = NULL;
+}
+
+/**
+ * Add a value unless the queue is full.
+ *
+ * @param queue: The queue.
+ * @param value: The value to add.
+ * @return false if the queue was full
+ */
+bool queue_try_push(queue_t *queue, uint32 value) {
+	uint64 position = __atomic_load_n(&queue->enqueue_position, __ATOMIC_RELAXED);
+	queue_cell_t *cell;
+	int64 difference;
+
+	for (;;) {
+		cell = &queue->cells[position & queue->mask];
+		difference = (int64) (__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) - position);
+		if (difference == 0) {
+			if (__atomic_compare_exchange_n(&queue->enqueue_position, &position, position + 1,
+					true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if (difference < 0) {
+			return false;
+		} else {
+			position = __atomic_load_n(&queue->enqueue_position, __ATOMIC_RELAXED);
+		}
+	}
+
+	cell->value = value;
+	__atomic_store_n(&cell->sequence, position + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+/**
+ * Remove the oldest value unless the queue is empty.
+ *
+ * @param queue: The queue.
+ * @param value: Receives the value.
+ * @return false if the queue was empty
+ */
+bool queue_try_pop(queue_t *queue, uint32 *value) {
+	uint64 position = __atomic_load_n(&queue->dequeue_position, __ATOMIC_RELAXED);
+	queue_cell_t *cell;
+	int64 difference;
+
+	for (;;) {
+		cell = &queue->cells[position & queue->mask];
+		difference = (int64) (__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) - (position + 1));
+		if (difference == 0) {
+			if (__atomic_compare_exchange_n(&queue->dequeue_position, &position, position + 1,
+					true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if (difference < 0) {
+			return false;
+		} else {
+			position = __atomic_load_n(&queue->dequeue_position, __ATOMIC_RELAXED);
+		}
+	}
+
+	*value = cell->value;
+	__atomic_store_n(&cell->sequence, position + queue->mask + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+/**
+ * Wait a little before retrying a queue: spin briefly, then yield, then sleep,
+ * so an idle stage costs next to nothing.
+ *
+ * @param attempts: Failed attempts so far; start at 0 and reset after a success.
+ */
+void queue_wait(int *attempts) {
+	struct timespec pause = { 0, BACKOFF_NANOSECONDS };
+
+	if (++*attempts < SPIN_LIMIT)
+		__asm__ __volatile__("" ::: "memory");
+	else if (*attempts < YIELD_LIMIT)
+		sched_yield();
+	else
+		nanosleep(&pause, NULL);
+}
+
+/**
+ * Add a value, waiting while the queue is full.
+ *
+ * @param queue: The queue.
+ * @param value: The value to add.
+ */
+void queue_push(queue_t *queue, uint32 value) {
+	int attempts = 0;
+
+	while (!queue_try_push(queue, value))
+		queue_wait(&attempts);
+}
+
+/**
+ * Remove the oldest value, waiting while the queue is empty.
+ *
+ * @param queue: The queue.
+ * @return The value
+ */
+uint32 queue_pop(queue_t *queue) {
+	uint32 value;
+	int attempts = 0;
+
+	while (!queue_try_pop(queue, &value))
+		queue_wait(&attempts);
+	return value;
+}
@@ -0,0 +1,60 @@
+/******************************************************************************
+ * Bounded lock-free queues for handing work between threads.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef QUEUE_H
+#define QUEUE_H 1
+
+#include "rhoTypes.h"
+
+#define QUEUE_CACHE_LINE 64
+
+/*
+ * Vyukov's bounded multi-producer multi-consumer queue of 32-bit values. Each
+ * cell carries a sequence number that says whether it is ready to be written
+ * or read on the current lap, so producers and consumers only contend on the
+ * two position counters, which sit on separate cache lines. A push releases
+ * everything written before it to the thread that pops the value.
+ */
+typedef struct {
+	uint64 sequence;
+	uint32 value;
+} queue_cell_t;
+
+typedef struct {
+	queue_cell_t *cells;
+	uint64 mask;			// Capacity - 1; the capacity is a power of two
+	char pad0[QUEUE_CACHE_LINE];
+	uint64 enqueue_position;
+	char pad1[QUEUE_CACHE_LINE];
+	uint64 dequeue_position;
+	char pad2[QUEUE_CACHE_LINE];
+} queue_t;
+
+bool init_queue(queue_t *queue, uint32 capacity);
+void free_queue(queue_t *queue);
+
+bool queue_try_push(queue_t *queue, uint32 value);
+bool queue_try_pop(queue_t *queue, uint32 *value);
+void queue_push(queue_t *queue, uint32 value);
+uint32 queue_pop(queue_t *queue);
+void queue_wait(int *attempts);
+
+#endif // QUEUE_H
@@ -0,0 +1,399 @@
+/******************************************************************************
+ * A store of walks that ended without a factor, to carry them on later.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gmp.h>
+
+#include "resume.h"
+#include "rho.h"
+
+#define RESUME_FIELDS 10
+#define RESUME_SEPARATORS " \t\r\n"
+
+typedef struct {
+	char *engine;
+	mpz_t n;
+	uint32 exponent;
+	uint32 constant;
+	mpz_t start;
+	walk_state_t walk;
+} walk_record_t;
+
+bool resume_open = false;
+
+static char *store_path = NULL;
+static bool store_dirty = false;
+static pthread_mutex_t store_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static walk_record_t *records = NULL;
+static uint32 record_count = 0;
+static uint32 allocated_records = 0;
+
+// Open-addressed index of records; slots hold index + 1, 0 if empty
+static uint32 *record_hash = NULL;
+static uint32 hash_size = 0;		// Always a power of two
+
+static uint32 hash_walk(const char *engine, mpz_t n, uint32 exponent, uint32 constant, mpz_t start) {
+	uint64 h = (uint64) mpz_getlimbn(n, 0) ^ ((uint64) mpz_size(n) << 56);
+
+	h = (h ^ mpz_getlimbn(start, 0)) * 0x9e3779b97f4a7c15ULL;
+	h = (h ^ ((uint64) exponent << 32 | constant)) * 0x9e3779b97f4a7c15ULL;
+	h ^= (unsigned char) engine[0];
+	return (uint32) (h >> 32);
+}
+
+// Find the slot holding the walk, or the empty slot where it would go
+static uint32 find_slot(const char *engine, mpz_t n, uint32 exponent, uint32 constant, mpz_t start) {
+	uint32 mask = hash_size - 1;
+	uint32 slot = hash_walk(engine, n, exponent, constant, start) & mask;
+	walk_record_t *record;
+
+	while (record_hash[slot] != 0) {
+		record = &records[record_hash[slot] - 1];
+		if (record->exponent == exponent && record->constant == constant
+				&& mpz_cmp(record->n, n) == 0 && mpz_cmp(record->start, start) == 0
+				&& strcmp(record->engine, engine) == 0)
+			break;
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+static void rebuild_hash(uint32 size) {
+	uint32 i;
+
+	free(record_hash);
+	hash_size = size;
+	record_hash = (uint32 *) calloc(hash_size, sizeof(uint32));
+	for (i = 0; i < record_count; i++) {
+		walk_record_t *record = &records[i];
+
+		record_hash[find_slot(record->engine, record->n, record->exponent, record->constant,
+				record->start)] = i + 1;
+	}
+}
+
+// Append a record for a walk not yet in the store and index it at slot
+static walk_record_t *add_record(uint32 slot, const char *engine) {
+	walk_record_t *record;
+
+	if (record_count == allocated_records) {
+		allocated_records = allocated_records ? 2 * allocated_records : 64;
+		records = (walk_record_t *) realloc(records, allocated_records * sizeof(walk_record_t));
+	}
+	record = &records[record_count++];
+	record->engine = strdup(engine);
+	mpz_init(record->n);
+	mpz_init(record->start);
+	mpz_init(record->walk.x);
+	mpz_init(record->walk.y);
+	record_hash[slot] = record_count;
+	return record;
+}
+
+static void grow_if_full(void) {
+	if (2 * (record_count + 1) > hash_size)
+		rebuild_hash(2 * hash_size);
+}
+
+// Parse one store line into a record; false if it is malformed
+static bool parse_record(char *line) {
+	char *fields[RESUME_FIELDS], *rest;
+	mpz_t n, start, values[2];
+	unsigned long numbers[5];
+	char *end;
+	bool ok = true;
+	int i;
+
+	fields[0] = strtok_r(line, RESUME_SEPARATORS, &rest);
+	for (i = 1; i < RESUME_FIELDS && fields[i - 1]; i++)
+		fields[i] = strtok_r(NULL, RESUME_SEPARATORS, &rest);
+	if (!fields[RESUME_FIELDS - 1] || strtok_r(NULL, RESUME_SEPARATORS, &rest))
+		return false;
+
+	// exponent, constant, iterations, power, position
+	for (i = 0; i < 5; i++) {
+		const char *field = fields[i < 2 ? i + 2 : i + 3];
+
+		errno = 0;
+		numbers[i] = strtoul(field, &end, 16);
+		if (*end != '\0' || errno != 0 || (i != 2 && numbers[i] > 0xffffffffUL))
+			return false;
+	}
+
+	// n, start, x, y
+	mpz_init(n);
+	mpz_init(start);
+	for (i = 0; i < 2; i++)
+		mpz_init(values[i]);
+	ok = mpz_set_str(n, fields[1], 16) == 0 && mpz_set_str(start, fields[4], 16) == 0
+		&& mpz_set_str(values[0], fields[8], 16) == 0 && mpz_set_str(values[1], fields[9], 16) == 0
+		&& mpz_sgn(n) > 0 && numbers[2] > 0;
+	if (ok) {
+		uint32 slot;
+		walk_record_t *record;
+
+		grow_if_full();
+		slot = find_slot(fields[0], n, numbers[0], numbers[1], start);
+		record = record_hash[slot] ? &records[record_hash[slot] - 1] : add_record(slot, fields[0]);
+		mpz_set(record->n, n);
+		mpz_set(record->start, start);
+		record->exponent = numbers[0];
+		record->constant = numbers[1];
+		record->walk.iterations = numbers[2];
+		record->walk.power = numbers[3];
+		record->walk.position = numbers[4];
+		mpz_set(record->walk.x, values[0]);
+		mpz_set(record->walk.y, values[1]);
+	}
+	mpz_clear(n);
+	mpz_clear(start);
+	for (i = 0; i < 2; i++)
+		mpz_clear(values[i]);
+	return ok;
+}
+
+/**
+ * Load a resume store and record walks into it from now on. A store that
+ * does not exist yet starts out empty.
+ *
+ * @param path: The store file.
+ * @return true on success
+ */
+bool open_resume_store(const char *path) {
+	FILE *file;
+	char *line = NULL;
+	size_t line_size = 0;
+	uint32 line_number = 0;
+
+	store_path = strdup(path);
+	hash_size = 64;
+	record_hash = (uint32 *) calloc(hash_size, sizeof(uint32));
+	resume_open = true;
+
+	file = fopen(path, "r");
+	if (!file) {
+		if (errno == ENOENT)
+			return true;
+		perror(path);
+		return false;
+	}
+	while (getline(&line, &line_size, file) >= 0) {
+		line_number++;
+		if (line[strspn(line, RESUME_SEPARATORS)] == '\0' || line[0] == '#')
+			continue;
+		if (!parse_record(line))
+			fprintf(stderr, "Ignoring bad resume record on line %u.\n", line_number);
+	}
+	free(line);
+	fclose(file);
+	return true;
+}
+
+static bool write_store(void) {
+	size_t length = strlen(store_path);
+	char *temporary = (char *) malloc(length + 5);
+	FILE *file;
+	uint32 i;
+	bool ok;
+
+	memcpy(temporary, store_path, length);
+	memcpy(temporary + length, ".tmp", 5);
+	file = fopen(temporary, "w");
+	if (!file) {
+		perror(temporary);
+		free(temporary);
+		return false;
+	}
+
+	fprintf(file, "%s\n", RESUME_HEADER);
+	for (i = 0; i < record_count; i++) {
+		walk_record_t *record = &records[i];
+
+		gmp_fprintf(file, "%s %Zx %x %x %Zx %llx %x %x %Zx %Zx\n", record->engine, record->n,
+				record->exponent, record->constant, record->start, record->walk.iterations,
+				record->walk.power, record->walk.position, record->walk.x, record->walk.y);
+	}
+	ok = !ferror(file);
+	ok = fclose(file) == 0 && ok;
+	if (ok && rename(temporary, store_path) != 0)
+		ok = false;
+	if (!ok) {
+		perror(store_path);
+		remove(temporary);
+	}
+	free(temporary);
+	return ok;
+}
+
+/**
+ * Write the store back if any walk was recorded, and forget it.
+ *
+ * @return true on success
+ */
+bool close_resume_store(void) {
+	bool ok = true;
+	uint32 i;
+
+	if (!resume_open)
+		return true;
+	if (store_dirty)
+		ok = write_store();
+
+	for (i = 0; i < record_count; i++) {
+		free(records[i].engine);
+		mpz_clear(records[i].n);
+		mpz_clear(records[i].start);
+		mpz_clear(records[i].walk.x);
+		mpz_clear(records[i].walk.y);
+	}
+	free(records);
+	free(record_hash);
+	free(store_path);
+	records = NULL;
+	record_hash = NULL;
+	store_path = NULL;
+	record_count = allocated_records = hash_size = 0;
+	store_dirty = false;
+	resume_open = false;
+	return ok;
+}
+
+/**
+ * Look up the current walk of fobj, and load where it stopped into
+ * fobj->rho_obj.walk. Without a record, the walk starts fresh.
+ *
+ * @param fobj: The factorization object, with the walk chosen.
+ * @return true if the walk was found
+ */
+bool find_walk(fact_obj_t *fobj) {
+	rho_obj_t *rho = &fobj->rho_obj;
+	uint32 slot;
+	bool found;
+
+	pthread_mutex_lock(&store_lock);
+	slot = find_slot(engine_name, rho->gmp_n, rho->exponent, rho->polynomials[rho->curr_poly], rho->start);
+	found = record_hash[slot] != 0;
+	if (found) {
+		walk_state_t *walk = &records[record_hash[slot] - 1].walk;
+
+		rho->walk.iterations = walk->iterations;
+		rho->walk.power = walk->power;
+		rho->walk.position = walk->position;
+		mpz_set(rho->walk.x, walk->x);
+		mpz_set(rho->walk.y, walk->y);
+	} else {
+		rho->walk.iterations = 0;
+	}
+	pthread_mutex_unlock(&store_lock);
+	return found;
+}
+
+/**
+ * Record where the walk just run stopped, if it got further than the store
+ * knew about.
+ *
+ * @param fobj: The factorization object, after run_rho.
+ */
+void record_walk(fact_obj_t *fobj) {
+	rho_obj_t *rho = &fobj->rho_obj;
+	uint32 constant = rho->polynomials[rho->curr_poly];
+	walk_record_t *record;
+	uint32 slot;
+
+	if (rho->walk.iterations == 0)
+		return;
+
+	pthread_mutex_lock(&store_lock);
+	grow_if_full();
+	slot = find_slot(engine_name, rho->gmp_n, rho->exponent, constant, rho->start);
+	if (record_hash[slot] == 0) {
+		record = add_record(slot, engine_name);
+		mpz_set(record->n, rho->gmp_n);
+		mpz_set(record->start, rho->start);
+		record->exponent = rho->exponent;
+		record->constant = constant;
+		record->walk.iterations = 0;
+	} else {
+		record = &records[record_hash[slot] - 1];
+	}
+	if (rho->walk.iterations > record->walk.iterations) {
+		record->walk.iterations = rho->walk.iterations;
+		record->walk.power = rho->walk.power;
+		record->walk.position = rho->walk.position;
+		mpz_set(record->walk.x, rho->walk.x);
+		mpz_set(record->walk.y, rho->walk.y);
+		store_dirty = true;
+	}
+	pthread_mutex_unlock(&store_lock);
+}
+
+/**
+ * Set up an engine to carry on a stored walk.
+ *
+ * @param fobj: The factorization object.
+ * @param kernel: The engine's kernel for n.
+ * @param x: Receives the tortoise, in the kernel's form.
+ * @param y: Receives the hare, in the kernel's form.
+ * @return true if there is a walk to carry on; its counts are in fobj->rho_obj.walk
+ */
+bool resume_walk(fact_obj_t *fobj, const rho_kernel_t *kernel, mpz_t x, mpz_t y) {
+	walk_state_t *walk = &fobj->rho_obj.walk;
+
+	if (walk->iterations == 0)
+		return false;
+	mpz_set(x, walk->x);
+	mpz_set(y, walk->y);
+	kernel_enter(kernel, x, fobj->rho_obj.gmp_n);
+	kernel_enter(kernel, y, fobj->rho_obj.gmp_n);
+	return true;
+}
+
+/**
+ * Note where an engine stopped without a factor, for record_walk().
+ *
+ * @param fobj: The factorization object.
+ * @param kernel: The engine's kernel for n.
+ * @param x: The tortoise, in the kernel's form.
+ * @param y: The hare, in the kernel's form.
+ * @param iterations: Iterations walked, in the engine's own count.
+ * @param power: Brent: length of the current round.
+ * @param position: Brent: steps taken into the current round.
+ */
+void keep_walk(fact_obj_t *fobj, const rho_kernel_t *kernel, mpz_t x, mpz_t y, uint64 iterations,
+		uint32 power, uint32 position) {
+	walk_state_t *walk = &fobj->rho_obj.walk;
+
+	if (!resume_open)
+		return;
+	walk->iterations = iterations;
+	walk->power = power;
+	walk->position = position;
+	mpz_set(walk->x, x);
+	mpz_set(walk->y, y);
+	kernel_leave(kernel, walk->x);
+	kernel_leave(kernel, walk->y);
+}
@@ -0,0 +1,58 @@
+/******************************************************************************
+ * A store of walks that ended without a factor, to carry them on later.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef RESUME_H
+#define RESUME_H 1
+
+#include <gmp.h>
+
+#include "kernel.h"
+#include "rhoTypes.h"
+
+/*
+ * A walk is identified by the engine, n, the map x^e + c and its starting
+ * value. Once one has gone k iterations without a factor, every GCD up to k
+ * has come out 1, so a later run with a larger -i can start from the stored
+ * state at k instead of walking the same steps again, and a run whose limit
+ * is at most k can skip the walk outright.
+ *
+ * The store is a text file with one walk per line, numbers in hexadecimal:
+ *
+ *   engine n exponent constant start iterations power position x y
+ *
+ * It is read whole when opened and replaced through a temporary file when
+ * closed, so an interrupted run leaves the previous store intact.
+ */
+#define RESUME_HEADER "# rho resume store v1"
+
+extern bool resume_open;		// A store is open and walks are being recorded
+
+bool open_resume_store(const char *path);
+bool close_resume_store(void);
+
+bool find_walk(fact_obj_t *fobj);
+void record_walk(fact_obj_t *fobj);
+
+bool resume_walk(fact_obj_t *fobj, const rho_kernel_t *kernel, mpz_t x, mpz_t y);
+void keep_walk(fact_obj_t *fobj, const rho_kernel_t *kernel, mpz_t x, mpz_t y, uint64 iterations,
+		uint32 power, uint32 position);
+
+#endif // RESUME_H
@@ -1,7 +1,7 @@
 /******************************************************************************
  * Main module.
  *
- * Copyright 2017, 2019, 2021, Alexander Jones.
+ * Copyright 2017, 2019, 2021, 2026, Alexander Jones.
  *
  * Based on code from yafu, which has been placed into the public domain by its
  * author, Ben Buhrow.
@@ -29,44 +29,300 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <gmp.h>
 
+#include "affinity.h"
+#include "batchgcd.h"
 #include "carg_parser.h"
+#include "certify.h"
+#include "control.h"
+#include "input.h"
+#include "loop.h"
+#include "perf.h"
+#include "pipeline.h"
+#include "prng.h"
+#include "resume.h"
 #include "rho.h"
+#include "server.h"
+#include "trace.h"
 #include "types.h"
+#include "walks.h"
 
 static int loop_count = LOOP_COUNT;
+static bool write_output = true;		// Off for the repeats of --loop
 
 static bool only_one_poly = false;
 static int single_poly;
+static long map_exponent = 2;
 
-int gcd_step = GCD_STEP;
-int max_iterations = MAX_ITERATIONS;
+static const char *batch_file = NULL;
+static InputFormat batch_format = INPUT_TEXT;
+static bool batch_gcd_first = false;
+
+static const char *trace_file = NULL;
+static uint32 trace_interval = 1;
+
+static const char *serve_path = NULL;
+static const char *seed_arg = NULL;
+static const char *cpus_arg = NULL;
+static const char *numa_arg = NULL;
+static const char *resume_file = NULL;
+static int threads = 0;
 
-uint32 *polys;
-mpz_t constant;
+// Codes for options that only have a long form
+enum { OPT_TRACE = 256, OPT_TRACE_EVERY, OPT_BATCH_GCD, OPT_TIME_LIMIT, OPT_CPU_LIMIT, OPT_SERVE, OPT_SEED, OPT_CPUS, OPT_NUMA, OPT_PERF, OPT_RESUME, OPT_WALKS, OPT_CERTIFY };
+
+int gcd_step = 0;
+int max_iterations = MAX_ITERATIONS;
 
 static void rho_loop(fact_obj_t *fobj);
 static bool rho_inner(fact_obj_t *fobj);
 
+// Add a factor to the list, and write it out at once if fobj streams its factors
+static void found_factor(fact_obj_t *fobj, mpz_t factor, FinishingState finishingState) {
+	add_to_factor_list(fobj, factor, finishingState);
+	if (fobj->factor_stream) {
+		certify_factor(fobj->factor_stream, factor);
+		fflush(fobj->factor_stream);
+	}
+}
+
+/**
+ * Factor one composite into a factorization object that may be reused.
+ *
+ * A factor known from batch GCD may itself be composite, so it is factored
+ * first, and whatever rho leaves of it goes back into the rest of the number.
+ * The iteration limit and time budget in fobj->rho_obj are left as the caller
+ * set them.
+ *
+ * @param fobj: The factorization object; receives the factors and cofactor.
+ * @param composite: The number to factor.
+ * @param shared: A factor already known from batch GCD, or NULL.
+ */
+void factor_composite(fact_obj_t *fobj, mpz_t composite, mpz_ptr shared) {
+	mpz_t rest;
+
+	clear_factor_list(fobj);
+	fobj->rho_obj.walk_seed = 0;
+	if (!shared || mpz_cmp_ui(shared, 1) <= 0) {
+		mpz_set(fobj->rho_obj.gmp_n, composite);
+		rho_loop(fobj);
+		return;
+	}
+
+	mpz_init(rest);
+	mpz_divexact(rest, composite, shared);
+	mpz_set(fobj->rho_obj.gmp_n, shared);
+	rho_loop(fobj);
+	mpz_mul(fobj->rho_obj.gmp_n, fobj->rho_obj.gmp_n, rest);
+	mpz_clear(rest);
+	rho_loop(fobj);
+}
+
 /**
  * Run rho algorithm.
  *
- * @param compositeNumber: The number to factor.
+ * @param composite: The number to factor.
+ * @param shared: A factor already known from batch GCD, or NULL.
  * @return 0 on success
  */
-static int rho(char *composite) {
+static int rho(mpz_t composite, mpz_ptr shared) {
 	fact_obj_t fobj;
 	init_factobj(&fobj);
-	mpz_set_str(fobj.rho_obj.gmp_n, composite, 10);
-	polys = fobj.rho_obj.polynomials;
-	rho_loop(&fobj);
-	print_factors(&fobj);
+	fobj.rho_obj.iterations = max_iterations;
+	start_budget(&fobj, time_limit, cpu_limit);
+	if (!write_output) {
+		factor_composite(&fobj, composite, shared);
+	} else if (certify_output) {
+		fobj.factor_stream = stdout;
+		factor_composite(&fobj, composite, shared);
+		certify_end(stdout, &fobj);
+	} else {
+		factor_composite(&fobj, composite, shared);
+		print_factors(&fobj);
+	}
 	free_factobj(&fobj);
 	return 0;				// Always return 0 if there's no error
 }
 
+static void print_composite(FILE *out, mpz_t composite) {
+	if (!write_output)
+		return;
+	if (certify_output) {
+		certify_composite(out, composite);
+		return;
+	}
+#if DEBUG
+	gmp_fprintf(out, "Composite: %Zd\n", composite);
+#else
+	gmp_fprintf(out, "%Zd\n", composite);
+#endif
+}
+
+// One batch result: the composite, its factors, and a separating blank line
+static void print_result(FILE *out, mpz_t composite, fact_obj_t *fobj) {
+	uint32 i;
+	int j;
+
+	if (!write_output)
+		return;
+	print_composite(out, composite);
+	if (certify_output) {
+		for (i = 0; i < fobj->num_factors; i++) {
+			for (j = 0; j < fobj->fobj_factors[i].count; j++)
+				certify_factor(out, fobj->fobj_factors[i].factor);
+		}
+		certify_end(out, fobj);
+	} else {
+		fprint_factors(out, fobj);
+	}
+	fprintf(out, "\n");
+}
+
+static void free_composites(mpz_t *composites, size_t count) {
+	size_t i;
+
+	for (i = 0; i < count; i++)
+		mpz_clear(composites[i]);
+	free(composites);
+}
+
+/*
+ * Read the whole batch, take the batch GCD of all composites so that factors
+ * shared between them are found up front, then run rho on what is left.
+ */
+static int rho_batch_shared(input_t *input) {
+	mpz_t *composites, *gcds, shared;
+	size_t count = 0, allocated = 64, i;
+	int status, result = 0;
+
+	composites = (mpz_t *) malloc(allocated * sizeof(mpz_t));
+	if (!composites) {
+		fprintf(stderr, "Out of memory.\n");
+		return 1;
+	}
+	mpz_init(composites[0]);
+	while ((status = read_composite(input, composites[count])) != 0) {
+		if (status < 0) {
+			result = 1;
+			continue;
+		}
+		if (++count == allocated) {
+			mpz_t *grown = (mpz_t *) realloc(composites, allocated * 2 * sizeof(mpz_t));
+
+			if (!grown) {
+				fprintf(stderr, "Out of memory.\n");
+				free_composites(composites, count);		// The next one is not initialized yet
+				return 1;
+			}
+			composites = grown;
+			allocated *= 2;
+		}
+		mpz_init(composites[count]);
+	}
+
+	gcds = (mpz_t *) malloc((count ? count : 1) * sizeof(mpz_t));
+	if (!gcds) {
+		fprintf(stderr, "Out of memory.\n");
+		free_composites(composites, count + 1);
+		return 1;
+	}
+	for (i = 0; i < count; i++)
+		mpz_init(gcds[i]);
+	batch_gcd(gcds, composites, count);
+
+	mpz_init(shared);
+	for (i = 0; i < count && !stop_requested; i++) {
+		split_shared(shared, gcds, composites, count, i);
+		print_composite(stdout, composites[i]);
+		rho(composites[i], shared);
+		if (write_output)
+			printf("\n");
+	}
+	mpz_clear(shared);
+
+	for (i = 0; i < count; i++)
+		mpz_clear(gcds[i]);
+	free(gcds);
+	free_composites(composites, count + 1);
+	return result;
+}
+
+/**
+ * Run rho algorithm on every composite in a batch input.
+ *
+ * Each composite is echoed before its factors, and results are separated by a
+ * blank line. The composites are spread over worker threads and the results
+ * still come out in input order. Large text files are mapped and split between
+ * the workers by byte range.
+ *
+ * @param path: The batch file, or "-" for standard input.
+ * @return 0 on success, 1 if the input could not be read or held bad records
+ */
+static int rho_batch(const char *path) {
+	mapped_input_t mapped;
+	input_t input;
+	int result;
+
+	// Large text files are read in place by the workers instead of through one reader
+	if (!batch_gcd_first && batch_format == INPUT_TEXT && map_input(&mapped, path)) {
+		if (mapped.size >= SHARDED_MIN_SIZE) {
+			result = run_shards(&mapped, threads, print_result);
+			unmap_input(&mapped);
+			return result;
+		}
+		unmap_input(&mapped);
+	}
+
+	if (!open_input(&input, path, batch_format))
+		return 1;
+
+	if (batch_gcd_first)
+		result = rho_batch_shared(&input);
+	else
+		result = run_pipeline(&input, threads, print_result);
+	close_input(&input);
+	return result;
+}
+
+/**
+ * Factor the composite, or the batch, loop_count times.
+ *
+ * Only the first run writes its factors. With more than one run, each is timed
+ * and a summary of the runs goes to stderr.
+ *
+ * @param n: The composite, unless a batch file was given.
+ * @return The value returned by rho() or rho_batch() for the last run
+ */
+static int rho_runs(mpz_t n) {
+	double *seconds = (double *) malloc(loop_count * sizeof(double));
+	double start;
+	int runs, result = 0;
+
+	if (loop_count > 1)
+		count_allocations();
+	for (runs = 0; runs < loop_count && !stop_requested && result == 0; runs++) {
+		write_output = runs == 0;
+		start = control_clock();
+		if (batch_file) {
+			result = rho_batch(batch_file);
+		} else {
+			if (certify_output && write_output)
+				certify_composite(stdout, n);
+			result = rho(n, NULL);
+		}
+		seconds[runs] = control_clock() - start;
+		fflush(stdout);
+	}
+	if (loop_count > 1 && runs > 0)
+		loop_report(seconds, runs);
+	free(seconds);
+	return result;
+}
+
 static void rho_loop(fact_obj_t *fobj) {
 	if ((mpz_cmp_ui(fobj->rho_obj.gmp_n, 1) == 0) || (mpz_cmp_ui(fobj->rho_obj.gmp_n, 0) == 0))
 		return;
@@ -80,7 +336,7 @@ static void rho_loop(fact_obj_t *fobj) {
 		rho_inner(fobj);		// Actually run rho algorithm (dependent on algorithm linked)
 	} else {
 		fobj->rho_obj.curr_poly = 0;		// An index for polys
-		while (fobj->rho_obj.curr_poly < NUM_POLYS) {	// Loop through polynomials
+		while (fobj->rho_obj.curr_poly < NUM_POLYS && !stop_requested && !out_of_budget(fobj)) {	// Loop through polynomials
 			fullyFactored = rho_inner(fobj);		// Actually run rho algorithm (dependent on algorithm linked)
 			if (fullyFactored) {		// We found a factor!
 				break;
@@ -90,25 +346,67 @@ static void rho_loop(fact_obj_t *fobj) {
 	}
 }
 
+/*
+ * Set the iteration map, starting value and constant of the walk for the
+ * current polynomial: X_0 and the fixed constant, or with --seed, draws from
+ * the walk's own seed.
+ */
+static void choose_walk(fact_obj_t *fobj) {
+	prng_t prng;
+
+	fobj->rho_obj.exponent = map_exponent;
+	if (!seeded) {
+		fobj->rho_obj.walk_seed = 0;
+		mpz_set_ui(fobj->rho_obj.start, X_0);
+		return;
+	}
+
+	fobj->rho_obj.walk_seed = walk_seed(fobj->rho_obj.gmp_n, fobj->rho_obj.curr_poly);
+	seed_prng(&prng, fobj->rho_obj.walk_seed);
+	fobj->rho_obj.polynomials[fobj->rho_obj.curr_poly] = prng_constant(&prng, fobj->rho_obj.gmp_n);
+	prng_below(&prng, fobj->rho_obj.start, fobj->rho_obj.gmp_n);
+}
+
 static bool rho_inner(fact_obj_t *fobj) {
+	choose_walk(fobj);
+
 	//for each different constant, first check primalty because each
 	//time around the number may be different
 	if (is_mpz_prp(fobj->rho_obj.gmp_n)) {
 		FinishingState dummyState = {-1, -1};
-		add_to_factor_list(fobj, fobj->rho_obj.gmp_n, dummyState);
+		found_factor(fobj, fobj->rho_obj.gmp_n, dummyState);
 		mpz_set_ui(fobj->rho_obj.gmp_n, 1);
 		return true;
 	}
 
-	//call rho algorithm
-	FinishingState finishingState = run_rho(fobj);
+	//call rho algorithm, or race it across threads
+	fobj->rho_obj.ttime = control_clock();
+	FinishingState finishingState;
+	if (walk_threads > 1) {
+		finishingState = run_walks(fobj);
+	} else if (resume_open && find_walk(fobj) && fobj->rho_obj.walk.iterations >= fobj->rho_obj.iterations) {
+		//already walked this far without a factor
+		finishingState.final_index = fobj->rho_obj.walk.iterations;
+		finishingState.function_calls = finishingState.gcd_calls = 0;
+		mpz_set_ui(fobj->rho_obj.gmp_f, 0);
+	} else {
+		perf_begin(PERF_WALK);
+		finishingState = run_rho(fobj);
+		perf_end(PERF_WALK);
+		if (perf_enabled)
+			perf_report(fobj->rho_obj.gmp_n, fobj->rho_obj.polynomials[fobj->rho_obj.curr_poly],
+					finishingState.final_index);
+		record_walk(fobj);
+	}
+	if (finishingState.final_index > 0)
+		count_iterations(finishingState.final_index);
 
 	//check to see if 'f' is non-trivial
 	if ((mpz_cmp_ui(fobj->rho_obj.gmp_f, 1) > 0)
 		&& (mpz_cmp(fobj->rho_obj.gmp_f, fobj->rho_obj.gmp_n) < 0)) {
 		//non-trivial factor found
 
-		add_to_factor_list(fobj, fobj->rho_obj.gmp_f, finishingState);
+		found_factor(fobj, fobj->rho_obj.gmp_f, finishingState);
 
 		//reduce input
 		mpz_tdiv_q(fobj->rho_obj.gmp_n, fobj->rho_obj.gmp_n, fobj->rho_obj.gmp_f);
@@ -116,8 +414,48 @@ static bool rho_inner(fact_obj_t *fobj) {
 	return false;
 }
 
+/*
+ * Turn on seeded walks. A "random" seed comes from the clock and process ID,
+ * and is printed so the run can be repeated.
+ */
+static bool set_seed(const char *arg) {
+	struct timespec ts;
+	char *end;
+
+	if (strcmp(arg, "random") == 0) {
+		clock_gettime(CLOCK_REALTIME, &ts);
+		run_seed = mix_seed(ts.tv_sec * 1000000000ULL + ts.tv_nsec, getpid());
+		fprintf(stderr, "Seed: %" PRIu64 "\n", run_seed);
+	} else {
+		run_seed = strtoull(arg, &end, 0);
+		if (*arg == '\0' || *arg == '-' || *end != '\0')
+			return false;
+	}
+	seeded = true;
+	return true;
+}
+
 static const char * const program_year = "2023";
 
+// What configure found on the build target
+static const char * const build_features = ""
+#if HAVE_BMI2
+	" bmi2"
+#endif
+#if HAVE_ADX
+	" adx"
+#endif
+#if HAVE_AVX2
+	" avx2"
+#endif
+#if HAVE_AVX512IFMA
+	" avx512ifma"
+#endif
+#if HAVE_INT128
+	" int128"
+#endif
+	;
+
 static void show_version() {
 	printf("Rho Calculator\n");
 	printf("Copyright (C) %s Alexander Jones.\n", program_year);
@@ -125,6 +463,7 @@ static void show_version() {
 	printf("License GPLv3+: GNU GPL version 3 or later <https://gnu.org/licenses/gpl.html>\n"
 			"This is free software: you are free to change and redistribute it.\n"
 			"There is NO WARRANTY, to the extent permitted by law.\n");
+	printf("Built with GMP %s; target features:%s\n", gmp_version, *build_features ? build_features : " none");
 }
 
 /**
@@ -132,20 +471,39 @@ static void show_version() {
  *
  * @param argc: The number of arguments.
  * @param argv: The array of arguments.
- * @return Value returned by rho() (currently always 0)
+ * @return Value returned by rho(), rho_batch() or serve(), or 128 plus the signal number if stopped early
  */
 int main(const int argc, const char * const argv[]) {
-	char composite[MAX_NUM_SIZE];
-	*composite = '\0';
+	const char *composite = NULL;
+	mpz_t n;
+	int result;
 
 	// Legal command-line arguments
 	const struct ap_Option options[] =
 		{
 		{ 'V', "version",    ap_no    },	// Display the version information
 		{ 'p', "polynomial", ap_yes   },	// Use a specific polynomial
-		{ 'g', "gcd-step",   ap_yes   },	// How many GCD calculations to merge at once
+		{ 'e', "exponent",   ap_yes   },	// Iterate x^e + c (default: 2)
+		{ 'g', "gcd-step",   ap_yes   },	// Steps per GCD (default: 0, adapt to n)
 		{ 'i', "iterations", ap_yes   },	// The iterations limit for the algorithm
-		{ 'l', "loop",       ap_yes   } };	// An optional number of times to repeat the whole thing
+		{ 'l', "loop",       ap_yes   },	// Repeat the whole run this many times, and time the runs
+		{ 'b', "base",       ap_yes   },	// The base of the composites (default: decimal or 0x/0b prefix)
+		{ 'f', "file",       ap_yes   },	// Factor every composite in a file ("-" for stdin)
+		{ 'r', "raw",        ap_no    },	// The batch file holds GMP raw (mpz_out_raw) records
+		{ OPT_TRACE,       "trace",       ap_yes },	// Write a binary walk trace to a file
+		{ OPT_TRACE_EVERY, "trace-every", ap_yes },	// Trace every k-th iteration (default: 1)
+		{ OPT_BATCH_GCD,   "batch-gcd",   ap_no  },	// Find factors shared across the batch before rho
+		{ OPT_TIME_LIMIT,  "time-limit",  ap_yes },	// Wall-clock seconds allowed per composite
+		{ OPT_CPU_LIMIT,   "cpu-limit",   ap_yes },	// CPU seconds allowed per composite
+		{ OPT_SERVE,       "serve",       ap_yes },	// Serve requests on a UNIX socket instead
+		{ OPT_SEED,        "seed",        ap_yes },	// Random walks from this seed, or "random" to pick one
+		{ OPT_CPUS,        "cpus",        ap_yes },	// Pin workers to these CPUs, e.g. "0-7,16-23"
+		{ OPT_NUMA,        "numa",        ap_yes },	// Pin workers to the CPUs of these NUMA nodes
+		{ OPT_PERF,        "perf",        ap_no  },	// Count cycles, instructions and misses per walk
+		{ OPT_RESUME,      "resume",      ap_yes },	// Carry on walks recorded in this store, and record new ones
+		{ OPT_WALKS,       "walks",       ap_yes },	// Race this many random walks on each number in threads
+		{ OPT_CERTIFY,     "certify",     ap_no  },	// Write factors as found, with primality certificates
+		{ 't', "threads",    ap_yes   } };	// Threads for --serve and batches (default: one per CPU)
 
 	// Parse the arguments
 	struct Arg_parser parser;
@@ -158,24 +516,118 @@ int main(const int argc, const char * const argv[]) {
 		switch (code) {
 			case 'V': show_version(); return 0;
 			case 'p': only_one_poly = true; single_poly = strtol(arg, NULL, 10); break;
+			case 'e': map_exponent = strtol(arg, NULL, 10); break;
 			case 'g': gcd_step = strtol(arg, NULL, 10); break;
 			case 'i': max_iterations = strtol(arg, NULL, 10); break;
 			case 'l': loop_count = strtol(arg, NULL, 10); break;
-			case '\0':
-				strncpy(composite, arg, MAX_NUM_SIZE - 1);
-				composite[MAX_NUM_SIZE - 1] = '\0';
-				break;
+			case 'b': input_base = strtol(arg, NULL, 10); break;
+			case 'f': batch_file = arg; break;
+			case 'r': batch_format = INPUT_RAW; break;
+			case OPT_TRACE: trace_file = arg; break;
+			case OPT_TRACE_EVERY: trace_interval = strtoul(arg, NULL, 10); break;
+			case OPT_BATCH_GCD: batch_gcd_first = true; break;
+			case OPT_TIME_LIMIT: time_limit = strtod(arg, NULL); break;
+			case OPT_CPU_LIMIT: cpu_limit = strtod(arg, NULL); break;
+			case OPT_SERVE: serve_path = arg; break;
+			case OPT_SEED: seed_arg = arg; break;
+			case OPT_CPUS: cpus_arg = arg; break;
+			case OPT_NUMA: numa_arg = arg; break;
+			case OPT_PERF: enable_perf(); break;
+			case OPT_RESUME: resume_file = arg; break;
+			case OPT_WALKS: walk_threads = strtol(arg, NULL, 10); break;
+			case OPT_CERTIFY: certify_output = true; break;
+			case 't': threads = strtol(arg, NULL, 10); break;
+			case '\0': composite = arg; break;
 		}
 		if (!code) {
 			break;
 		}
 	}
 
-	if (!(*composite)) {
+	if (input_base != 0 && (input_base < 2 || input_base > 62)) {
+		fprintf(stderr, "Base must be between 2 and 62.\n");
+		return 1;
+	}
+
+	if (map_exponent < 2 || map_exponent > UINT32_MAX) {
+		fprintf(stderr, "Invalid --exponent value.\n");
+		return 1;
+	}
+
+	if (gcd_step < 0) {
+		fprintf(stderr, "Invalid --gcd-step value.\n");
+		return 1;
+	}
+
+	if (time_limit < 0 || cpu_limit < 0) {
+		fprintf(stderr, "Invalid --time-limit or --cpu-limit value.\n");
+		return 1;
+	}
+
+	if (loop_count < 1 || (loop_count > 1 && (resume_file || (batch_file && strcmp(batch_file, "-") == 0)))) {
+		fprintf(stderr, "Invalid --loop value, or --loop with --resume or standard input.\n");
+		return 1;
+	}
+
+	if (walk_threads < 0) {
+		fprintf(stderr, "Invalid --walks value.\n");
+		return 1;
+	}
+
+	if (threads < 0) {
+		fprintf(stderr, "Invalid --threads value.\n");
+		return 1;
+	}
+	if ((cpus_arg && !restrict_to_cpus(cpus_arg)) || (numa_arg && !restrict_to_nodes(numa_arg))
+		|| !apply_affinity())
+		return 1;
+	if (threads == 0)
+		threads = worker_cpu_count ? worker_cpu_count : MAX(sysconf(_SC_NPROCESSORS_ONLN), 1);
+
+	if (seed_arg && !set_seed(seed_arg)) {
+		fprintf(stderr, "Invalid --seed value.\n");
+		return 1;
+	}
+
+	if (!serve_path && !batch_file && (!composite || !(*composite))) {
 		fprintf(stderr, "No composite provided.\n");
 		return 1;
 	}
 
-	// Tail-call the rho starter
-	return rho(composite);
+	if (trace_file && !open_trace(trace_file, trace_interval)) {
+		return 1;
+	}
+
+	if (resume_file && !open_resume_store(resume_file)) {
+		close_trace();
+		return 1;
+	}
+
+	install_control_handlers();
+
+	if (serve_path) {
+		result = serve(serve_path, threads);
+		if (!close_resume_store())
+			result = 1;
+		close_trace();
+		return result;
+	}
+
+	mpz_init(n);
+	if (!batch_file && !parse_composite(n, composite)) {
+		fprintf(stderr, "Invalid composite: %s\n", composite);
+		result = 1;
+	} else {
+		result = rho_runs(n);
+	}
+	mpz_clear(n);
+
+	if (!close_resume_store())
+		result = 1;
+	close_trace();
+
+	// Exit the way the shell reports a killed job, after printing what was found
+	if (stop_requested)
+		return 128 + stop_requested;
+	return result;
 }
@@ -1,7 +1,7 @@
 /******************************************************************************
  * Main header file.
  *
- * Copyright 2017, 2019, 2021, Alexander Jones.
+ * Copyright 2017, 2019, 2021, 2026, Alexander Jones.
  *
  * Based on code from yafu, which has been placed into the public domain by its
  * author, Ben Buhrow.
@@ -31,6 +31,7 @@
 #include <gmp.h>
 
 #include "factor.h"
+#include "kernel.h"
 
 #include "rhoTypes.h"
 
@@ -40,31 +41,61 @@
 #define C_MAX 10
 #define X_0 0
 #define G_CONSTANT 1
-#define GCD_STEP 10
 
 extern int gcd_step, max_iterations;
-extern uint32 *polys;
-extern mpz_t constant;
+
+extern const char engine_name[];	// Defined by each engine
 
 #if DEBUG
-#define square(out,in) (g((out), (in), fobj->rho_obj.gmp_n, temp, &finishingState))
+#define square(out,in) (g((out), (in), fobj->rho_obj.gmp_n, temp, &kernel, &finishingState))
 #else
-#define square(out,in) (g((out), (in), fobj->rho_obj.gmp_n, temp))
+#define square(out,in) (g((out), (in), fobj->rho_obj.gmp_n, temp, &kernel))
 #endif
 
+#define difference(out,a,b) (absolute_difference((out), (a), (b), &kernel))
+#define multiply(out,a,b) (modular_multiply((out), (a), (b), fobj->rho_obj.gmp_n, &kernel))
+
 #if DEBUG
-static inline void g(mpz_t output, mpz_t input, mpz_t n, mpz_t temp, FinishingState *finishingState) {
+static inline void g(mpz_t output, mpz_t input, mpz_t n, mpz_t temp, const rho_kernel_t *kernel, FinishingState *finishingState) {
 #else
-static inline void g(mpz_t output, mpz_t input, mpz_t n, mpz_t temp) {
+static inline void g(mpz_t output, mpz_t input, mpz_t n, mpz_t temp, const rho_kernel_t *kernel) {
 #endif
-	mpz_mul(temp, input, input);
-	mpz_add(temp, temp, constant);
-	mpz_tdiv_r(output, temp, n);
+	if (kernel->map) {
+		kernel->map(output, input, kernel);
+	} else if (kernel->exponent == 2) {
+		mpz_mul(temp, input, input);
+		mpz_add(temp, temp, kernel->constant);
+		mpz_tdiv_r(output, temp, n);
+	} else {
+		mpz_powm_ui(temp, input, kernel->exponent, n);
+		mpz_add(temp, temp, kernel->constant);
+		mpz_tdiv_r(output, temp, n);
+	}
 #if DEBUG
 	finishingState->function_calls++;
 #endif
 }
 
+static inline void absolute_difference(mpz_t output, mpz_t a, mpz_t b, const rho_kernel_t *kernel) {
+	if (kernel->diff) {
+		kernel->diff(output, a, b);
+	} else {
+		mpz_sub(output, a, b);
+		mpz_abs(output, output);
+	}
+}
+
+/* Multiply two walk-form values mod n. The result is only good for GCDs with n. */
+static inline void modular_multiply(mpz_t output, mpz_t a, mpz_t b, mpz_t n, const rho_kernel_t *kernel) {
+	if (kernel->mul) {
+		kernel->mul(output, a, b, kernel);
+	} else {
+		mpz_mul(output, a, b);
+		mpz_tdiv_r(output, output, n);
+	}
+}
+
 FinishingState run_rho(fact_obj_t *fobj);
+void factor_composite(fact_obj_t *fobj, mpz_t composite, mpz_ptr shared);
 
 #endif // RHO_H
@@ -25,13 +25,14 @@
 #ifndef RHOTYPES_H
 #define RHOTYPES_H 1
 
+#include <stdio.h>
+
 #include <gmp.h>
 
 #include "types.h"
 
 /*-------------------------------CUSTOM----------------------------------*/
 
-#define MAX_NUM_SIZE 501
 #define NUM_POLYS 3
 
 typedef enum { false = 0, true = 1 } bool;
@@ -52,12 +53,28 @@ typedef struct
 	mpz_t factor;
 	int count;
 	FactorType type;
+} factor_t;
+
+/* Diagnostics for a factor, kept apart from the values that dedup scans. */
+typedef struct
+{
 	FinishingState finishingState;
 	uint32 polynomial;
-} factor_t;
+	uint64 seed;				//walk seed, or 0 for the fixed walks
+} factor_info_t;
 
 /*-------------------------FROM FACTOR.H---------------------------------*/
 
+/* Where a walk stopped without a factor, at a GCD, so it can be carried on. */
+typedef struct
+{
+	uint64 iterations;			//iterations walked, in the engine's own count; 0 for none
+	uint32 power;				//Brent: length of the current round
+	uint32 position;			//Brent: steps taken into the current round
+	mpz_t x;				//tortoise, plain value mod n
+	mpz_t y;				//hare, plain value mod n
+} walk_state_t;
+
 typedef struct
 {
 	mpz_t gmp_n;
@@ -66,7 +83,13 @@ typedef struct
 	uint32 num_poly;
 	uint32 *polynomials;
 	uint32 curr_poly;			//current polynomial in the list of polynomials
+	mpz_t start;				//starting value of the current walk
+	uint32 exponent;			//e in the iteration map x^e + c
+	uint64 walk_seed;			//seed of the current walk, or 0 for the fixed walks
+	walk_state_t walk;			//where the current walk resumes, and then where it stopped
 	double ttime;
+	double deadline;			//monotonic time to give up at, or 0 for none
+	double cpu_deadline;			//thread CPU time to give up at, or 0 for none
 } rho_obj_t;
 
 typedef struct
@@ -75,8 +98,15 @@ typedef struct
 
 	//global storage for a list of factors
 	factor_t *fobj_factors;
+	factor_info_t *fobj_factor_info;	//parallel to fobj_factors
 	uint32 num_factors;
 	uint32 allocated_factors;
+
+	//open-addressed index of fobj_factors; slots hold index + 1, 0 if empty
+	uint32 *factor_hash;
+	uint32 hash_size;			//always a power of two
+
+	FILE *factor_stream;			//where to write each factor as it is found, or NULL
 } fact_obj_t;
 
 #endif // RHOTYPES_H
@@ -0,0 +1,101 @@
+/******************************************************************************
+ * GCD scheduling for the rho walks.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#include <time.h>
+
+#include <gmp.h>
+
+#include "schedule.h"
+
+#define CALIBRATION_MULS 64
+#define CALIBRATION_GCDS 8
+#define CALIBRATION_SIZES 64
+
+// Measured caps by limb count of n, 0 until measured
+static __thread uint32 calibrated_caps[CALIBRATION_SIZES + 1];
+
+static double now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Time multiplications and GCDs at the size of n and size the block to match. */
+static uint32 calibrate(const rho_kernel_t *kernel, mpz_t n) {
+	mpz_t a, b, gcd;
+	double start, mul_time, gcd_time;
+	int i;
+
+	mpz_init(a);
+	mpz_init(b);
+	mpz_init(gcd);
+	mpz_tdiv_q_ui(a, n, 3);
+	mpz_tdiv_q_ui(b, n, 7);
+	modular_multiply(a, a, b, n, kernel);	// Warm up allocations and caches
+	mpz_gcd(gcd, a, n);
+
+	start = now();
+	for (i = 0; i < CALIBRATION_MULS; i++)
+		modular_multiply(a, a, b, n, kernel);
+	mul_time = (now() - start) / CALIBRATION_MULS;
+
+	start = now();
+	for (i = 0; i < CALIBRATION_GCDS; i++) {
+		mpz_add_ui(a, a, 1);
+		mpz_gcd(gcd, a, n);
+	}
+	gcd_time = (now() - start) / CALIBRATION_GCDS;
+
+	mpz_clear(a);
+	mpz_clear(b);
+	mpz_clear(gcd);
+
+	if (mul_time <= 0)
+		return GCD_BLOCK_MAX;
+	return (uint32) MAX(1, MIN(GCD_COST_SHARE * gcd_time / mul_time, GCD_BLOCK_MAX));
+}
+
+/**
+ * Set up the GCD schedule for one walk.
+ *
+ * @param schedule: The schedule to initialize.
+ * @param kernel: The walk's kernel.
+ * @param n: The number being factored.
+ */
+void init_gcd_schedule(gcd_schedule_t *schedule, const rho_kernel_t *kernel, mpz_t n) {
+	size_t size = mpz_size(n);
+
+	schedule->pending = 0;
+	if (gcd_step > 0) {
+		schedule->length = schedule->cap = gcd_step;
+		return;
+	}
+
+	schedule->length = 1;
+	if (size > CALIBRATION_SIZES) {
+		schedule->cap = calibrate(kernel, n);
+	} else {
+		if (!calibrated_caps[size])
+			calibrated_caps[size] = calibrate(kernel, n);
+		schedule->cap = calibrated_caps[size];
+	}
+}
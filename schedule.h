@@ -0,0 +1,64 @@
+/******************************************************************************
+ * GCD scheduling for the rho walks.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef SCHEDULE_H
+#define SCHEDULE_H 1
+
+#include <gmp.h>
+
+#include "rho.h"
+
+/*
+ * The walks multiply their differences together mod n and take one GCD per
+ * block of steps; a prime of n divides the product exactly when it divides
+ * one of the differences. A block whose GCD is not 1 is replayed a step at a
+ * time from its saved start, so the factor and ending index are the same as
+ * with a GCD on every step.
+ *
+ * With gcd_step set, every block has that many steps. At 0 the first block has
+ * one step and each block that finds nothing doubles the next, up to a cap at
+ * which the GCD costs about 1/GCD_COST_SHARE of the multiplications in its
+ * block, as measured for the size of n on this machine.
+ */
+#define GCD_COST_SHARE 16
+#define GCD_BLOCK_MAX 1024
+
+typedef struct {
+	uint32 length;			// Steps in the current block
+	uint32 cap;			// Longest block to grow to
+	uint32 pending;			// Steps taken since the last GCD
+} gcd_schedule_t;
+
+void init_gcd_schedule(gcd_schedule_t *schedule, const rho_kernel_t *kernel, mpz_t n);
+
+/* Count a step; true when the block is full and its GCD is due. */
+static inline bool gcd_due(gcd_schedule_t *schedule) {
+	return ++schedule->pending >= schedule->length;
+}
+
+/* Start a new block after a GCD. */
+static inline void gcd_taken(gcd_schedule_t *schedule) {
+	schedule->pending = 0;
+	if (schedule->length < schedule->cap)
+		schedule->length = MIN(schedule->length * 2, schedule->cap);
+}
+
+#endif // SCHEDULE_H
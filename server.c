@@ -0,0 +1,293 @@
+/******************************************************************************
+ * Daemon mode serving factorization requests over a UNIX socket.
+ *
+ * A fixed pool of threads accepts connections on one listening socket, and
+ * each thread keeps its factorization object between requests. Requests are
+ * text, one per line, any number per connection:
+ *
+ *   <composite> [iterations=N] [time-limit=S] [cpu-limit=S]
+ *
+ * Omitted budgets default to the command line's. The answer is one line per
+ * distinct factor, then the cofactor if one is left, then "done":
+ *
+ *   factor <factor> <count> <polynomial constant> <ending index> <function calls>
+ *   cofactor <cofactor>
+ *   done
+ *
+ * or a single "error <reason>" line. Ending index and function calls are only
+ * counted in DEBUG builds and are 0 otherwise.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <gmp.h>
+
+#include "affinity.h"
+#include "control.h"
+#include "input.h"
+#include "perf.h"
+#include "rho.h"
+#include "server.h"
+#include "trace.h"
+
+#define REQUEST_SEPARATORS " \t\r\n"
+
+typedef struct {
+	pthread_t thread;
+	int index;			// Position in the pool
+	int listener;
+	int connection;			// Connection being served, or -1
+} server_thread_t;
+
+// Guards every server_thread_t.connection, so a stop can cut idle clients off
+static pthread_mutex_t connections_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void set_connection(server_thread_t *self, int fd) {
+	pthread_mutex_lock(&connections_lock);
+	self->connection = fd;
+	if (fd >= 0 && stop_requested)
+		shutdown(fd, SHUT_RD);
+	pthread_mutex_unlock(&connections_lock);
+}
+
+// A whole number of iterations that the engines' int counters can reach
+static bool parse_iterations(const char *value, long *iterations) {
+	char *end;
+
+	errno = 0;
+	*iterations = strtol(value, &end, 10);
+	return end != value && *end == '\0' && errno == 0 && *iterations > 0 && *iterations <= INT_MAX;
+}
+
+// A time limit in seconds, with nothing after the number
+static bool parse_seconds(const char *value, double *seconds) {
+	char *end;
+
+	errno = 0;
+	*seconds = strtod(value, &end);
+	return end != value && *end == '\0' && errno == 0 && *seconds >= 0;
+}
+
+static void serve_request(fact_obj_t *fobj, mpz_t composite, char *line, FILE *out) {
+	char *token, *value, *rest = NULL;
+	long iterations = max_iterations;
+	double wall = time_limit, cpu = cpu_limit;
+	bool valid;
+	uint32 i;
+
+	token = strtok_r(line, REQUEST_SEPARATORS, &rest);
+	if (!token)
+		return;				// Blank lines get no answer
+	if (!parse_composite(composite, token)) {
+		fprintf(out, "error invalid composite\n");
+		return;
+	}
+
+	while ((token = strtok_r(NULL, REQUEST_SEPARATORS, &rest)) != NULL) {
+		value = strchr(token, '=');
+		if (!value) {
+			fprintf(out, "error expected name=value: %s\n", token);
+			return;
+		}
+		*value++ = '\0';
+		if (strcmp(token, "iterations") == 0) {
+			valid = parse_iterations(value, &iterations);
+		} else if (strcmp(token, "time-limit") == 0) {
+			valid = parse_seconds(value, &wall);
+		} else if (strcmp(token, "cpu-limit") == 0) {
+			valid = parse_seconds(value, &cpu);
+		} else {
+			fprintf(out, "error unknown budget: %s\n", token);
+			return;
+		}
+		if (!valid) {
+			fprintf(out, "error invalid budget\n");
+			return;
+		}
+	}
+
+	fobj->rho_obj.iterations = iterations;
+	start_budget(fobj, wall, cpu);
+	factor_composite(fobj, composite, NULL);
+
+	for (i = 0; i < fobj->num_factors; i++) {
+		factor_info_t *info = &fobj->fobj_factor_info[i];
+
+		gmp_fprintf(out, "factor %Zd %d %u %d %d\n", fobj->fobj_factors[i].factor,
+			fobj->fobj_factors[i].count, fobj->rho_obj.polynomials[info->polynomial],
+			info->finishingState.final_index, info->finishingState.function_calls);
+	}
+	if (mpz_cmp_ui(fobj->rho_obj.gmp_n, 1) > 0)
+		gmp_fprintf(out, "cofactor %Zd\n", fobj->rho_obj.gmp_n);
+	fprintf(out, "done\n");
+}
+
+static void serve_connection(fact_obj_t *fobj, mpz_t composite, int fd) {
+	FILE *in = fdopen(dup(fd), "r");
+	FILE *out = fdopen(dup(fd), "w");
+	char *line = NULL;
+	size_t size = 0;
+
+	if (in && out) {
+		while (!stop_requested && getline(&line, &size, in) >= 0) {
+			serve_request(fobj, composite, line, out);
+			if (fflush(out) != 0)
+				break;			// The client went away
+		}
+	}
+
+	free(line);
+	if (in)
+		fclose(in);
+	if (out)
+		fclose(out);
+}
+
+static void *serve_thread(void *arg) {
+	server_thread_t *self = (server_thread_t *) arg;
+	fact_obj_t fobj;
+	mpz_t composite;
+	int fd;
+
+	pin_worker(self->index);
+	init_factobj(&fobj);
+	mpz_init(composite);
+
+	while (!stop_requested) {
+		fd = accept(self->listener, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			break;				// The listener was shut down
+		}
+		set_connection(self, fd);
+		serve_connection(&fobj, composite, fd);
+		set_connection(self, -1);
+		close(fd);
+	}
+
+	end_trace_thread();
+	end_perf_thread();
+	mpz_clear(composite);
+	free_factobj(&fobj);
+	return NULL;
+}
+
+/**
+ * Serve factorization requests until SIGINT or SIGTERM.
+ *
+ * @param path: The UNIX socket to listen on; a stale socket there is replaced,
+ *              but any other file is left alone.
+ * @param threads: How many requests to work on at once.
+ * @return 0 after a clean shutdown, 1 if the socket or threads could not be set up
+ */
+int serve(const char *path, int threads) {
+	struct sockaddr_un address;
+	struct stat existing;
+	server_thread_t *pool;
+	sigset_t signals, previous;
+	int listener, started, i;
+
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		fprintf(stderr, "Socket path too long: %s\n", path);
+		return 1;
+	}
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+
+	// Only ever remove a socket left behind by an earlier server
+	if (lstat(path, &existing) == 0) {
+		if (!S_ISSOCK(existing.st_mode)) {
+			fprintf(stderr, "Not a socket, will not replace it: %s\n", path);
+			return 1;
+		}
+		unlink(path);
+	}
+
+	pool = (server_thread_t *) malloc(threads * sizeof(server_thread_t));
+	if (!pool) {
+		fprintf(stderr, "Out of memory.\n");
+		return 1;
+	}
+
+	listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0) {
+		perror("socket");
+		free(pool);
+		return 1;
+	}
+	if (bind(listener, (struct sockaddr *) &address, sizeof(address)) < 0
+		|| listen(listener, SOMAXCONN) < 0) {
+		perror(path);
+		close(listener);
+		free(pool);
+		return 1;
+	}
+
+	// Only this thread takes the control signals; the pool inherits them blocked
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	sigaddset(&signals, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &signals, &previous);
+	signal(SIGPIPE, SIG_IGN);
+
+	for (started = 0; started < threads; started++) {
+		pool[started].index = started;
+		pool[started].listener = listener;
+		pool[started].connection = -1;
+		if (pthread_create(&pool[started].thread, NULL, serve_thread, &pool[started]) != 0)
+			break;
+	}
+
+	if (started > 0) {
+		while (!stop_requested)
+			sigsuspend(&previous);
+	} else {
+		fprintf(stderr, "Could not start any server threads.\n");
+	}
+	pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+	// Wake threads blocked in accept() or waiting on idle clients
+	shutdown(listener, SHUT_RDWR);
+	pthread_mutex_lock(&connections_lock);
+	for (i = 0; i < started; i++) {
+		if (pool[i].connection >= 0)
+			shutdown(pool[i].connection, SHUT_RD);
+	}
+	pthread_mutex_unlock(&connections_lock);
+
+	for (i = 0; i < started; i++)
+		pthread_join(pool[i].thread, NULL);
+
+	free(pool);
+	close(listener);
+	unlink(path);
+	return started > 0 ? 0 : 1;
+}
@@ -0,0 +1,173 @@
+/******************************************************************************
+ * Walk tracing.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <gmp.h>
+
+#include "trace.h"
+
+/*
+ * Each thread fills its own buffer and hands it to the kernel with a single
+ * write() when the next record would not fit. The file is opened O_APPEND,
+ * so buffers from different threads never interleave, and no locks are
+ * needed anywhere on the producing side.
+ */
+#define TRACE_BUFFER_SIZE (1 << 20)
+
+uint32 trace_every = 0;
+__thread uint16 trace_walk = 0;
+
+static int trace_fd = -1;
+
+static __thread unsigned char *trace_buffer = NULL;
+static __thread size_t trace_used = 0;
+
+/**
+ * Start tracing to a file.
+ *
+ * @param path: The trace file to create.
+ * @param every: Record every every-th iteration (at least 1).
+ * @return true on success
+ */
+bool open_trace(const char *path, uint32 every) {
+	trace_file_header_t header;
+
+	trace_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+	if (trace_fd < 0) {
+		perror(path);
+		return false;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+	header.version = TRACE_VERSION;
+	header.every = every ? every : 1;
+	if (write(trace_fd, &header, sizeof(header)) != sizeof(header)) {
+		perror(path);
+		close(trace_fd);
+		trace_fd = -1;
+		return false;
+	}
+
+	trace_every = header.every;
+	return true;
+}
+
+/**
+ * Write out the calling thread's buffered records.
+ */
+void flush_trace(void) {
+	if (trace_fd >= 0 && trace_used > 0) {
+		if (write(trace_fd, trace_buffer, trace_used) != (ssize_t) trace_used)
+			perror("trace");
+	}
+	trace_used = 0;
+}
+
+/**
+ * Write out the calling thread's buffered records and free its buffer. Every
+ * thread that may trace calls this before it exits.
+ */
+void end_trace_thread(void) {
+	flush_trace();
+	free(trace_buffer);
+	trace_buffer = NULL;
+}
+
+void close_trace(void) {
+	end_trace_thread();
+	trace_every = 0;
+	if (trace_fd >= 0)
+		close(trace_fd);
+	trace_fd = -1;
+}
+
+static size_t value_bytes(mpz_t x) {
+	return x ? (mpz_sizeinbase(x, 2) + 7) / 8 : 0;
+}
+
+static void export_value(unsigned char *out, mpz_t x, size_t bytes, const rho_kernel_t *kernel) {
+	mpz_t plain;
+
+	if (!bytes)
+		return;
+	memset(out, 0, bytes);
+	if (kernel && (kernel->limbs || kernel->special_bits)) {
+		mpz_init_set(plain, x);
+		kernel_leave(kernel, plain);
+		mpz_export(out, NULL, -1, 1, 0, 0, plain);
+		mpz_clear(plain);
+	} else {
+		mpz_export(out, NULL, -1, 1, 0, 0, x);
+	}
+}
+
+/**
+ * Append a record to the calling thread's trace buffer.
+ *
+ * @param kind: The kind of record.
+ * @param constant: The polynomial constant of the walk.
+ * @param index: The iteration count.
+ * @param x: The first value (may be NULL).
+ * @param y: The second value (may be NULL).
+ * @param kernel: The kernel whose representation x and y are in, or NULL if
+ *                they are plain values.
+ */
+void trace_record(TraceKind kind, uint32 constant, uint64 index, mpz_t x, mpz_t y,
+		const rho_kernel_t *kernel) {
+	trace_record_t record;
+	size_t x_bytes, y_bytes, size;
+
+	if (trace_fd < 0)
+		return;
+
+	// Values leaving Montgomery form are still below n, so size them by n
+	x_bytes = value_bytes(x);
+	y_bytes = value_bytes(y);
+	if (kernel && kernel->limbs) {
+		x_bytes = x ? kernel->limbs * sizeof(mp_limb_t) : 0;
+		y_bytes = y ? kernel->limbs * sizeof(mp_limb_t) : 0;
+	}
+	size = sizeof(record) + x_bytes + y_bytes;
+
+	// Without a buffer the record is dropped, as one too large for it would be
+	if (!trace_buffer && !(trace_buffer = (unsigned char *) malloc(TRACE_BUFFER_SIZE)))
+		return;
+	if (trace_used + size > TRACE_BUFFER_SIZE)
+		flush_trace();
+	if (size > TRACE_BUFFER_SIZE)
+		return;
+
+	memset(&record, 0, sizeof(record));
+	record.kind = kind;
+	record.walk = trace_walk;
+	record.constant = constant;
+	record.index = index;
+	record.x_bytes = x_bytes;
+	record.y_bytes = y_bytes;
+
+	memcpy(trace_buffer + trace_used, &record, sizeof(record));
+	export_value(trace_buffer + trace_used + sizeof(record), x, x_bytes, kernel);
+	export_value(trace_buffer + trace_used + sizeof(record) + x_bytes, y, y_bytes, kernel);
+	trace_used += size;
+}
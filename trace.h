@@ -0,0 +1,94 @@
+/******************************************************************************
+ * Walk tracing.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef TRACE_H
+#define TRACE_H 1
+
+#include <gmp.h>
+
+#include "kernel.h"
+#include "rhoTypes.h"
+
+/*
+ * A trace file is a trace_file_header_t followed by records, each a
+ * trace_record_t followed by x_bytes bytes of x and y_bytes bytes of y, as
+ * little-endian magnitudes. All fields are in host byte order.
+ *
+ *   TRACE_START  x = n, y = starting value
+ *   TRACE_STEP   x = tortoise, y = hare, every trace_every-th iteration
+ *   TRACE_GCD    x = GCD, at sampled iterations and whenever it is not 1
+ *   TRACE_END    x = factor found (0 if none)
+ */
+#define TRACE_MAGIC "RHOTRACE"
+#define TRACE_VERSION 1
+
+typedef enum { TRACE_START = 0, TRACE_STEP = 1, TRACE_GCD = 2, TRACE_END = 3 } TraceKind;
+
+typedef struct {
+	char magic[8];
+	uint32 version;
+	uint32 every;
+} trace_file_header_t;
+
+typedef struct {
+	uint8 kind;
+	uint8 reserved;
+	uint16 walk;			// Distinguishes concurrent walks
+	uint32 constant;		// Polynomial constant
+	uint64 index;			// Iteration count at the time of the record
+	uint32 x_bytes;
+	uint32 y_bytes;
+} trace_record_t;
+
+extern uint32 trace_every;		// Sampling interval, or 0 when tracing is off
+extern __thread uint16 trace_walk;	// Walk number stamped on this thread's records
+
+bool open_trace(const char *path, uint32 every);
+void flush_trace(void);
+void end_trace_thread(void);
+void close_trace(void);
+
+void trace_record(TraceKind kind, uint32 constant, uint64 index, mpz_t x, mpz_t y,
+		const rho_kernel_t *kernel);
+
+/*
+ * The hooks below are what the engines call. With tracing off they cost one
+ * load and a well-predicted branch.
+ */
+static inline void trace_step(uint32 constant, uint64 index, mpz_t x, mpz_t y,
+		const rho_kernel_t *kernel) {
+	if (__builtin_expect(trace_every != 0, 0) && index % trace_every == 0)
+		trace_record(TRACE_STEP, constant, index, x, y, kernel);
+}
+
+static inline void trace_gcd(uint32 constant, uint64 index, mpz_t gcd) {
+	if (__builtin_expect(trace_every != 0, 0)
+			&& (index % trace_every == 0 || mpz_cmp_ui(gcd, 1) != 0))
+		trace_record(TRACE_GCD, constant, index, gcd, NULL, NULL);
+}
+
+static inline void trace_event(TraceKind kind, uint32 constant, uint64 index, mpz_t x, mpz_t y,
+		const rho_kernel_t *kernel) {
+	if (__builtin_expect(trace_every != 0, 0))
+		trace_record(kind, constant, index, x, y, kernel);
+}
+
+#endif // TRACE_H
@@ -0,0 +1,105 @@
+/******************************************************************************
+ * Print a walk trace written with --trace as text.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <gmp.h>
+
+#include "trace.h"
+
+static const char * const kind_names[] = { "start", "step", "gcd", "end" };
+
+static bool read_value(FILE *file, mpz_t x, uint32 bytes, unsigned char **buffer, size_t *buffer_size) {
+	if (bytes > *buffer_size) {
+		*buffer = realloc(*buffer, bytes);
+		*buffer_size = bytes;
+	}
+	if (fread(*buffer, 1, bytes, file) != bytes)
+		return false;
+	mpz_import(x, bytes, -1, 1, 0, 0, *buffer);
+	return true;
+}
+
+/**
+ * Dump a trace file, one record per line:
+ *
+ *   <kind> <walk> <constant> <index> <x> [<y>]
+ *
+ * @param argc: The number of arguments.
+ * @param argv: The array of arguments.
+ * @return 0 on success
+ */
+int main(const int argc, const char * const argv[]) {
+	trace_file_header_t header;
+	trace_record_t record;
+	unsigned char *buffer = NULL;
+	size_t buffer_size = 0;
+	FILE *file;
+	mpz_t x, y;
+	int result = 0;
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s TRACE_FILE\n", argv[0]);
+		return 1;
+	}
+
+	file = fopen(argv[1], "rb");
+	if (!file) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	if (fread(&header, sizeof(header), 1, file) != 1
+			|| memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0
+			|| header.version != TRACE_VERSION) {
+		fprintf(stderr, "%s: not a version %d trace file\n", argv[1], TRACE_VERSION);
+		fclose(file);
+		return 1;
+	}
+	printf("# every %u\n", header.every);
+
+	mpz_init(x);
+	mpz_init(y);
+	while (fread(&record, sizeof(record), 1, file) == 1) {
+		if (record.kind > TRACE_END
+				|| !read_value(file, x, record.x_bytes, &buffer, &buffer_size)
+				|| !read_value(file, y, record.y_bytes, &buffer, &buffer_size)) {
+			fprintf(stderr, "%s: corrupt record\n", argv[1]);
+			result = 1;
+			break;
+		}
+
+		printf("%s %u %u %llu", kind_names[record.kind], record.walk, record.constant,
+			(unsigned long long) record.index);
+		if (record.x_bytes)
+			gmp_printf(" %Zd", x);
+		if (record.y_bytes)
+			gmp_printf(" %Zd", y);
+		printf("\n");
+	}
+
+	mpz_clear(x);
+	mpz_clear(y);
+	free(buffer);
+	fclose(file);
+	return result;
+}
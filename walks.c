@@ -0,0 +1,342 @@
+/******************************************************************************
+ * Independent rho walks on one number in threads, with one GCD between them.
+ *
+ * Each of walk_threads threads runs its own Brent walk with its own random
+ * starting value and constant, multiplying its differences into a product of
+ * its own. At the end of every block the walks meet at a barrier; the calling
+ * thread, which is also walk 0, multiplies the products together and takes a
+ * single GCD with n for all of them. Only when that GCD is not 1 does it look
+ * at the walks one by one, replaying the block of each walk that has a factor
+ * a step at a time from its saved start.
+ *
+ * With --cpus or --numa the walk threads are pinned like the other worker
+ * pools, and each sets up its own walk once pinned.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#include <pthread.h>
+
+#include "affinity.h"
+#include "control.h"
+#include "prng.h"
+#include "rho.h"
+#include "schedule.h"
+#include "trace.h"
+#include "walks.h"
+
+typedef struct walks walks_t;
+
+typedef struct {
+	walks_t *walks;
+	uint32 index;
+	uint32 constant;
+	rho_kernel_t kernel;
+	mpz_t x, y, product, temp;
+	uint32 power;			// Length of the current round
+	uint32 skip_counter;		// Steps taken into it
+	uint64 iterations;
+	uint32 restarts;		// Times the walk collapsed onto all of n and was reseeded
+	bool collapsed;			// Reseed before the next block
+	FinishingState finishingState;
+
+	// The walk at the start of the block, for a replay
+	mpz_t x_start, y_start;
+	uint32 power_start, skip_start;
+	uint64 block_start;
+	int calls_start;
+} walk_t;
+
+struct walks {
+	fact_obj_t *fobj;
+	walk_t *walk;
+	int count;
+	pthread_mutex_t start_lock;		// Held until every thread that could be started is
+	pthread_barrier_t barrier;
+	uint32 steps;			// Steps each walk takes in this block
+	bool done;
+};
+
+int walk_threads = 0;
+
+#if DEBUG
+#define walk_g(w, out, in) g((out), (in), (w)->walks->fobj->rho_obj.gmp_n, (w)->temp, &(w)->kernel, &(w)->finishingState)
+#else
+#define walk_g(w, out, in) g((out), (in), (w)->walks->fobj->rho_obj.gmp_n, (w)->temp, &(w)->kernel)
+#endif
+
+/*
+ * Walk 0 starts as the walk run_rho would take; the others, and any walk
+ * reseeded after collapsing, draw their constant and starting value from
+ * seeds of their own, so every walk is on a different map.
+ */
+static void seed_walk(walk_t *walk) {
+	fact_obj_t *fobj = walk->walks->fobj;
+	uint64 seed;
+	prng_t prng;
+
+	if (walk->index == 0 && walk->restarts == 0) {
+		walk->constant = fobj->rho_obj.polynomials[fobj->rho_obj.curr_poly];
+		mpz_set(walk->y, fobj->rho_obj.start);
+	} else {
+		seed = mix_seed(fobj->rho_obj.walk_seed
+				? fobj->rho_obj.walk_seed : walk_seed(fobj->rho_obj.gmp_n, fobj->rho_obj.curr_poly), walk->index);
+		seed_prng(&prng, walk->restarts ? mix_seed(seed, walk->restarts) : seed);
+		walk->constant = prng_constant(&prng, fobj->rho_obj.gmp_n);
+		prng_below(&prng, walk->y, fobj->rho_obj.gmp_n);
+	}
+	init_kernel(&walk->kernel, fobj->rho_obj.gmp_n, walk->constant, fobj->rho_obj.exponent);
+	walk->power = 1;
+	walk->skip_counter = 0;
+}
+
+static void init_walk(walk_t *walk, walks_t *walks, uint32 index) {
+	walk->walks = walks;
+	walk->index = index;
+	mpz_init(walk->x);
+	mpz_init(walk->y);
+	mpz_init(walk->temp);
+	mpz_init(walk->x_start);
+	mpz_init(walk->y_start);
+	mpz_init_set_ui(walk->product, 1);
+
+	walk->restarts = 0;
+	walk->collapsed = false;
+	seed_walk(walk);
+	walk->iterations = 0;
+	walk->finishingState.final_index = 0;
+	walk->finishingState.function_calls = 0;
+	walk->finishingState.gcd_calls = 0;
+}
+
+static void clear_walk(walk_t *walk) {
+	mpz_clear(walk->x);
+	mpz_clear(walk->y);
+	mpz_clear(walk->temp);
+	mpz_clear(walk->x_start);
+	mpz_clear(walk->y_start);
+	mpz_clear(walk->product);
+	clear_kernel(&walk->kernel);
+}
+
+// One Brent step: a new round starts from the hare once the last one is done
+static inline void step(walk_t *walk) {
+	if (walk->skip_counter == walk->power) {
+		mpz_set(walk->x, walk->y);
+		walk->power *= 2;
+		walk->skip_counter = 0;
+	}
+	walk_g(walk, walk->y, walk->y);
+	absolute_difference(walk->temp, walk->x, walk->y, &walk->kernel);
+	walk->iterations++;
+	walk->skip_counter++;
+	trace_step(walk->constant, walk->iterations, walk->x, walk->y, &walk->kernel);
+}
+
+static void start_walk(walk_t *walk) {
+	mpz_ptr n = walk->walks->fobj->rho_obj.gmp_n;
+
+	trace_event(TRACE_START, walk->constant, 0, n, walk->y, NULL);
+	kernel_enter(&walk->kernel, walk->y, n);
+	mpz_set(walk->x, walk->y);
+}
+
+static void walk_block(walk_t *walk, uint32 steps) {
+	mpz_ptr n = walk->walks->fobj->rho_obj.gmp_n;
+
+	// A walk that collapsed carries on from a fresh seed, still counting its iterations
+	if (walk->collapsed) {
+		clear_kernel(&walk->kernel);
+		walk->restarts++;
+		seed_walk(walk);
+		start_walk(walk);
+		walk->collapsed = false;
+	}
+
+	mpz_set(walk->x_start, walk->x);
+	mpz_set(walk->y_start, walk->y);
+	walk->power_start = walk->power;
+	walk->skip_start = walk->skip_counter;
+	walk->block_start = walk->iterations;
+	walk->calls_start = walk->finishingState.function_calls;
+
+	while (steps--) {
+		step(walk);
+		modular_multiply(walk->product, walk->product, walk->temp, n, &walk->kernel);
+	}
+}
+
+/*
+ * Step a walk whose block had a factor through it again, a GCD at a time,
+ * and leave the first GCD that is not 1 in gcd.
+ */
+static void replay_block(walk_t *walk, mpz_t gcd) {
+	mpz_ptr n = walk->walks->fobj->rho_obj.gmp_n;
+
+	mpz_set(walk->x, walk->x_start);
+	mpz_set(walk->y, walk->y_start);
+	walk->power = walk->power_start;
+	walk->skip_counter = walk->skip_start;
+	walk->iterations = walk->block_start;
+	walk->finishingState.function_calls = walk->calls_start;
+	do {
+		step(walk);
+		mpz_gcd(gcd, walk->temp, n);
+		trace_gcd(walk->constant, walk->iterations, gcd);
+	} while (mpz_cmp_ui(gcd, 1) == 0);
+}
+
+static void *walk_thread(void *argument) {
+	walk_t *walk = (walk_t *) argument;
+	walks_t *walks = walk->walks;
+
+	pthread_mutex_lock(&walks->start_lock);
+	pthread_mutex_unlock(&walks->start_lock);
+
+	// Each thread sets up its own walk once pinned, so the walk's numbers are on its node
+	pin_worker(walk->index);
+	init_walk(walk, walks, walk->index);
+	trace_walk = walk->index;
+	start_walk(walk);
+	for (;;) {
+		pthread_barrier_wait(&walks->barrier);
+		if (walks->done)
+			break;
+		walk_block(walk, walks->steps);
+		pthread_barrier_wait(&walks->barrier);
+	}
+	end_trace_thread();
+	return NULL;
+}
+
+/*
+ * Take the one GCD for the block; if it is not 1, find the walk with the
+ * factor. A walk whose block only gives n itself is reseeded, and the race
+ * goes on. Returns true when a factor is found.
+ */
+static bool take_gcd(walks_t *walks, mpz_t total, mpz_t gcd, FinishingState *finishingState) {
+	fact_obj_t *fobj = walks->fobj;
+	walk_t *walk;
+	int i;
+
+	mpz_set(total, walks->walk[0].product);
+	for (i = 1; i < walks->count; i++) {
+		mpz_mul(total, total, walks->walk[i].product);
+		mpz_tdiv_r(total, total, fobj->rho_obj.gmp_n);
+	}
+	mpz_gcd(gcd, total, fobj->rho_obj.gmp_n);
+	trace_gcd(walks->walk[0].constant, walks->walk[0].iterations, gcd);
+
+	// Replay the walks whose block has a factor, in order; the first proper one wins
+	if (mpz_cmp_ui(gcd, 1) != 0) {
+		for (i = 0; i < walks->count; i++) {
+			walk = &walks->walk[i];
+			mpz_gcd(gcd, walk->product, fobj->rho_obj.gmp_n);
+			if (mpz_cmp_ui(gcd, 1) == 0)
+				continue;
+			replay_block(walk, gcd);
+			if (mpz_cmp(gcd, fobj->rho_obj.gmp_n) != 0) {
+				mpz_set(fobj->rho_obj.gmp_f, gcd);
+				*finishingState = walk->finishingState;
+				finishingState->final_index = walk->iterations;
+				return true;
+			}
+			walk->collapsed = true;
+		}
+	}
+
+	for (i = 0; i < walks->count; i++)
+		mpz_set_ui(walks->walk[i].product, 1);
+	return false;
+}
+
+/**
+ * Race walk_threads independent walks on the current number.
+ *
+ * The iteration limit applies to each walk, and the calling thread's time and
+ * CPU budgets to the whole race.
+ *
+ * @param fobj: The factorization object; gmp_f receives the factor found, or 0.
+ * @return The finishing state of the walk that found the factor
+ */
+FinishingState run_walks(fact_obj_t *fobj) {
+	FinishingState finishingState = {0, 0, 0};
+	gcd_schedule_t schedule;
+	pthread_t *threads;
+	walks_t walks;
+	mpz_t total, gcd;
+	int started, i;
+
+	mpz_set_ui(fobj->rho_obj.gmp_f, 0);
+	walks.fobj = fobj;
+	walks.count = walk_threads;
+	walks.done = false;
+	walks.walk = (walk_t *) malloc(walks.count * sizeof(walk_t));
+	threads = (pthread_t *) malloc(walks.count * sizeof(pthread_t));
+	init_walk(&walks.walk[0], &walks, 0);
+	mpz_init(total);
+	mpz_init(gcd);
+
+	// Walks that cannot be started are left out of the race
+	flush_trace();
+	pthread_mutex_init(&walks.start_lock, NULL);
+	pthread_mutex_lock(&walks.start_lock);
+	for (started = 1; started < walks.count; started++) {
+		walks.walk[started].walks = &walks;
+		walks.walk[started].index = started;
+		if (pthread_create(&threads[started], NULL, walk_thread, &walks.walk[started]) != 0)
+			break;
+	}
+	walks.count = started;
+	pthread_barrier_init(&walks.barrier, NULL, walks.count);
+	pthread_mutex_unlock(&walks.start_lock);
+
+	start_walk(&walks.walk[0]);
+	init_gcd_schedule(&schedule, &walks.walk[0].kernel, fobj->rho_obj.gmp_n);
+	for (;;) {
+		walks.steps = MIN(schedule.length, fobj->rho_obj.iterations - walks.walk[0].iterations);
+		pthread_barrier_wait(&walks.barrier);
+		walk_block(&walks.walk[0], walks.steps);
+		pthread_barrier_wait(&walks.barrier);
+
+		if (take_gcd(&walks, total, gcd, &finishingState) || walks.walk[0].iterations >= fobj->rho_obj.iterations
+				|| check_control(fobj, walks.walk[0].iterations))
+			break;
+		gcd_taken(&schedule);
+	}
+	if (mpz_sgn(fobj->rho_obj.gmp_f) == 0) {
+		finishingState = walks.walk[0].finishingState;
+		finishingState.final_index = walks.walk[0].iterations;
+	}
+	trace_event(TRACE_END, walks.walk[0].constant, finishingState.final_index, fobj->rho_obj.gmp_f, NULL, NULL);
+
+	walks.done = true;
+	pthread_barrier_wait(&walks.barrier);
+	for (i = 1; i < walks.count; i++)
+		pthread_join(threads[i], NULL);
+	pthread_barrier_destroy(&walks.barrier);
+	pthread_mutex_destroy(&walks.start_lock);
+	for (i = 0; i < walks.count; i++)
+		clear_walk(&walks.walk[i]);
+
+	mpz_clear(total);
+	mpz_clear(gcd);
+	free(threads);
+	free(walks.walk);
+	return finishingState;
+}
@@ -0,0 +1,31 @@
+/******************************************************************************
+ * Independent rho walks on one number in threads, with one GCD between them.
+ *
+ * Copyright 2026, Alexander Jones.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file LICENSE.  If not, see http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef WALKS_H
+#define WALKS_H 1
+
+#include "rhoTypes.h"
+
+extern int walk_threads;		// Walks raced on each number, or 0 to use run_rho()
+
+FinishingState run_walks(fact_obj_t *fobj);
+
+#endif // WALKS_H